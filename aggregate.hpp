@@ -0,0 +1,85 @@
+#ifndef AGGREGATE_HPP
+#define AGGREGATE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+#include "hash_mix.hpp"
+
+// Aggregator policies for Tree<T, K, Aggregator>.
+// A policy describes a per-node summary of the node's subtree:
+//   value_type                     the stored summary
+//   enabled                        false skips all maintenance
+//   make(value)                    summary of a single node
+//   combine(acc, child_summary)    folds one child's summary into acc, called in child order
+//   combine_empty(acc)             folds an empty child slot (BST mode) in its place in that order
+// Summaries are recomputed along the root path on insert, so inserts cost O(K * depth).
+
+// Default policy: nothing is maintained
+template <typename T>
+struct NoAggregate {
+    struct value_type {};
+    static const bool enabled = false;
+
+    static value_type make(const T&) {
+        return value_type();
+    }
+
+    static void combine(value_type&, const value_type&) {}
+
+    static void combine_empty(value_type&) {}
+};
+
+// Subtree size, height (in nodes) and value sum
+template <typename T>
+struct SubtreeStats {
+    struct value_type {
+        size_t size;
+        size_t height;
+        T sum;
+    };
+    static const bool enabled = true;
+
+    static value_type make(const T& value) {
+        value_type stats;
+        stats.size = 1;
+        stats.height = 1;
+        stats.sum = value;
+        return stats;
+    }
+
+    static void combine(value_type& acc, const value_type& child) {
+        acc.size += child.size;
+        acc.height = std::max(acc.height, child.height + 1);
+        acc.sum = acc.sum + child.sum;
+    }
+
+    static void combine_empty(value_type&) {}
+};
+
+// Merkle hash of the subtree: the node's value hashed with std::hash<T>, then each child's
+// hash folded in child order. Equal hashes mean the same shape and values up to a 64-bit
+// collision, so Tree compares MerkleHash trees by root hash and Tree::diff can skip subtrees.
+// An empty child slot (BST mode) folds in a fixed marker, so a lone left child and a lone
+// right child hash differently.
+template <typename T>
+struct MerkleHash {
+    typedef uint64_t value_type;
+    static const bool enabled = true;
+
+    static value_type make(const T& value) {
+        return hash_mix(static_cast<uint64_t>(std::hash<T>()(value)));
+    }
+
+    // Mixing after every child makes the result depend on child order and nesting
+    static void combine(value_type& acc, const value_type& child) {
+        acc = hash_mix(acc ^ child);
+    }
+
+    static void combine_empty(value_type& acc) {
+        acc = hash_mix(acc ^ 0xa0761d6478bd642fULL);
+    }
+};
+
+#endif // AGGREGATE_HPP
@@ -0,0 +1,94 @@
+#ifndef BLOOM_FILTER_HPP
+#define BLOOM_FILTER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include "hash_mix.hpp"
+
+// Bloom filter over values hashed with Hash. possibly_contains() never misses an inserted
+// value; for other values it returns true with roughly the configured false-positive rate
+// while no more than the expected number of values have been inserted.
+// Sized by the standard formulas m = -n ln p / (ln 2)^2 bits and k = (m / n) ln 2 probes;
+// the k probe positions come from one hash by double hashing.
+// Hash is only called inside the member functions, so T needs a hash only if the filter is used.
+// A default-constructed filter has no bits and is disabled: it reports every value as possible.
+template <typename T, typename Hash = std::hash<T>>
+class BloomFilter {
+private:
+    std::vector<uint64_t> bits;
+    size_t bit_count;
+    size_t probes;
+    size_t inserted;
+
+    template <typename F>
+    void for_each_probe(const T& value, F f) const {
+        uint64_t h1 = hash_mix(static_cast<uint64_t>(Hash()(value)));
+        uint64_t h2 = hash_mix(h1) | 1;
+        for (size_t i = 0; i < probes; ++i) {
+            f(static_cast<size_t>((h1 + i * h2) % bit_count));
+        }
+    }
+
+public:
+    BloomFilter() : bit_count(0), probes(0), inserted(0) {}
+
+    BloomFilter(size_t expected_items, double false_positive_rate) : inserted(0) {
+        double n = static_cast<double>(std::max<size_t>(1, expected_items));
+        double p = std::min(0.5, std::max(1e-9, false_positive_rate));
+        double ln2 = std::log(2.0);
+        bit_count = std::max<size_t>(64, static_cast<size_t>(std::ceil(-n * std::log(p) / (ln2 * ln2))));
+        probes = std::max<size_t>(1, static_cast<size_t>(std::round(bit_count / n * ln2)));
+        bits.assign((bit_count + 63) / 64, 0);
+    }
+
+    bool enabled() const {
+        return bit_count != 0;
+    }
+
+    void insert(const T& value) {
+        if (!enabled()) return;
+        for_each_probe(value, [this](size_t bit) { bits[bit / 64] |= uint64_t(1) << (bit % 64); });
+        ++inserted;
+    }
+
+    // False means value was definitely never inserted
+    bool possibly_contains(const T& value) const {
+        if (!enabled()) return true;
+        bool all = true;
+        for_each_probe(value, [&](size_t bit) { all = all && (bits[bit / 64] >> (bit % 64) & 1); });
+        return all;
+    }
+
+    void clear() {
+        std::fill(bits.begin(), bits.end(), uint64_t(0));
+        inserted = 0;
+    }
+
+    size_t size() const {
+        return inserted;
+    }
+
+    size_t bit_size() const {
+        return bit_count;
+    }
+
+    size_t hash_count() const {
+        return probes;
+    }
+
+    size_t memory_bytes() const {
+        return bits.size() * sizeof(uint64_t);
+    }
+
+    // Expected false-positive rate at the current fill, (1 - e^(-kn/m))^k
+    double false_positive_rate() const {
+        if (!enabled()) return 1.0;
+        return std::pow(1.0 - std::exp(-double(probes) * inserted / bit_count), double(probes));
+    }
+};
+
+#endif // BLOOM_FILTER_HPP
@@ -0,0 +1,360 @@
+#ifndef BTREE_HPP
+#define BTREE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <iterator>
+#include <new>
+#include <utility>
+#include "tree.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Fanout whose key array fills one 64-byte cache line (16 ints, 8 doubles), never below 4
+template <typename T>
+constexpr int btree_default_fanout() {
+    return 64 / sizeof(T) + 1 < 4 ? 4 : int(64 / sizeof(T) + 1);
+}
+
+// Number of keys in the sorted range [keys, keys + count) that are less than value
+template <typename T>
+struct BTreeRank {
+    static int get(const T* keys, int count, const T& value) {
+        return int(std::lower_bound(keys, keys + count, value) - keys);
+    }
+};
+
+#if defined(__SSE2__)
+// Compares four keys per step; the keys are sorted, so the first block that is not
+// entirely below value ends the scan and its mask is a run of low bits
+template <>
+struct BTreeRank<int> {
+    static int get(const int* keys, int count, int value) {
+        const __m128i needle = _mm_set1_epi32(value);
+        int i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i));
+            int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(block, needle)));
+            if (mask != 0xf) return i + __builtin_popcount(mask);
+        }
+        while (i < count && keys[i] < value) ++i;
+        return i;
+    }
+};
+
+template <>
+struct BTreeRank<double> {
+    static int get(const double* keys, int count, double value) {
+        const __m128d needle = _mm_set1_pd(value);
+        int i = 0;
+        for (; i + 2 <= count; i += 2) {
+            int mask = _mm_movemask_pd(_mm_cmplt_pd(_mm_loadu_pd(keys + i), needle));
+            if (mask != 0x3) return i + __builtin_popcount(mask);
+        }
+        while (i < count && keys[i] < value) ++i;
+        return i;
+    }
+};
+#endif
+
+// Ordered set stored as a B+-tree with fanout K: inner nodes hold up to K - 1 separator keys
+// and K children, leaves hold up to K - 1 keys and are chained for range scans.
+// Keys of a node sit in one contiguous array at the start of a 64-byte aligned node, so with
+// the default fanout a search reads one cache line of keys per level instead of one Node
+// allocation per comparison; find and insert are O(log_K n).
+// Separator i is an upper bound for child i, so descent and leaf search both use the rank of
+// the value (the lower_bound position) and need only operator<.
+// This is its own class rather than a Tree<T, K> mode because Node keeps one value per node.
+template <typename T, int K = btree_default_fanout<T>()>
+class BTree {
+    static_assert(K >= 4, "BTree needs a fanout of at least 4");
+
+private:
+    struct alignas(64) BNode {
+        T keys[K - 1];
+        int count;
+        bool leaf;
+
+        // Being user-provided, this also lets Leaf and Inner start their members in the tail
+        // padding after leaf on GCC and Clang instead of at the next 64-byte boundary
+        BNode() : count(0), leaf(false) {}
+
+        // Plain new only guarantees 16-byte alignment before C++17, so nodes are placed by
+        // hand: over-allocate, round up, and keep the raw pointer just below the node
+        static void* operator new(size_t size) {
+            void* raw = ::operator new(size + 64 + sizeof(void*));
+            uintptr_t at = (reinterpret_cast<uintptr_t>(raw) + sizeof(void*) + 63) & ~uintptr_t(63);
+            reinterpret_cast<void**>(at)[-1] = raw;
+            return reinterpret_cast<void*>(at);
+        }
+
+        static void operator delete(void* node) {
+            if (node) ::operator delete(static_cast<void**>(node)[-1]);
+        }
+    };
+
+    struct Leaf : BNode {
+        Leaf* next;
+    };
+
+    struct Inner : BNode {
+        BNode* children[K];
+    };
+
+    BNode* root;
+    size_t count;
+    size_t levels;
+
+    static Leaf* make_leaf() {
+        Leaf* leaf = new Leaf();
+        leaf->count = 0;
+        leaf->leaf = true;
+        leaf->next = nullptr;
+        return leaf;
+    }
+
+    static Inner* make_inner() {
+        Inner* inner = new Inner();
+        inner->count = 0;
+        inner->leaf = false;
+        return inner;
+    }
+
+    static void destroy(BNode* node) {
+        if (!node) return;
+        if (node->leaf) {
+            delete static_cast<Leaf*>(node);
+            return;
+        }
+        Inner* inner = static_cast<Inner*>(node);
+        for (int i = 0; i <= inner->count; ++i) {
+            destroy(inner->children[i]);
+        }
+        delete inner;
+    }
+
+    static int rank(const BNode* node, const T& value) {
+        return BTreeRank<T>::get(node->keys, node->count, value);
+    }
+
+    // Splits the full child at index i of a non-full parent, inserting the new separator at i
+    static void split_child(Inner* parent, int i) {
+        BNode* child = parent->children[i];
+        T separator;
+        BNode* right;
+        if (child->leaf) {
+            Leaf* left = static_cast<Leaf*>(child);
+            Leaf* sibling = make_leaf();
+            int keep = K / 2;
+            sibling->count = K - 1 - keep;
+            std::move(left->keys + keep, left->keys + K - 1, sibling->keys);
+            left->count = keep;
+            sibling->next = left->next;
+            left->next = sibling;
+            separator = left->keys[keep - 1];
+            right = sibling;
+        } else {
+            Inner* left = static_cast<Inner*>(child);
+            Inner* sibling = make_inner();
+            int middle = (K - 1) / 2;
+            sibling->count = K - 2 - middle;
+            std::move(left->keys + middle + 1, left->keys + K - 1, sibling->keys);
+            std::copy(left->children + middle + 1, left->children + K, sibling->children);
+            left->count = middle;
+            separator = std::move(left->keys[middle]);
+            right = sibling;
+        }
+
+        std::move_backward(parent->keys + i, parent->keys + parent->count, parent->keys + parent->count + 1);
+        std::copy_backward(parent->children + i + 1, parent->children + parent->count + 1,
+                           parent->children + parent->count + 2);
+        parent->keys[i] = std::move(separator);
+        parent->children[i + 1] = right;
+        ++parent->count;
+    }
+
+    // Leaf and position of the first key not less than value
+    std::pair<const Leaf*, int> locate(const T& value) const {
+        const BNode* node = root;
+        if (!node) return std::make_pair(static_cast<const Leaf*>(nullptr), 0);
+        while (!node->leaf) {
+            node = static_cast<const Inner*>(node)->children[rank(node, value)];
+        }
+        const Leaf* leaf = static_cast<const Leaf*>(node);
+        int pos = rank(leaf, value);
+        if (pos == leaf->count) {
+            leaf = leaf->next;
+            pos = 0;
+        }
+        return std::make_pair(leaf, pos);
+    }
+
+public:
+    // Forward iterator over keys in ascending order, walking the leaf chain
+    class const_iterator {
+    private:
+        const Leaf* leaf;
+        int pos;
+
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef T value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const T* pointer;
+        typedef const T& reference;
+
+        const_iterator(const Leaf* leaf = nullptr, int pos = 0) : leaf(leaf), pos(pos) {}
+
+        const T& operator*() const {
+            return leaf->keys[pos];
+        }
+
+        const T* operator->() const {
+            return &leaf->keys[pos];
+        }
+
+        const_iterator& operator++() {
+            if (++pos == leaf->count) {
+                leaf = leaf->next;
+                pos = 0;
+            }
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator before = *this;
+            ++*this;
+            return before;
+        }
+
+        bool operator==(const const_iterator& other) const {
+            return leaf == other.leaf && pos == other.pos;
+        }
+
+        bool operator!=(const const_iterator& other) const {
+            return !(*this == other);
+        }
+    };
+
+    BTree() : root(nullptr), count(0), levels(0) {}
+
+    BTree(const BTree&) = delete;
+    BTree& operator=(const BTree&) = delete;
+
+    BTree(BTree&& other) : root(other.root), count(other.count), levels(other.levels) {
+        other.root = nullptr;
+        other.count = 0;
+        other.levels = 0;
+    }
+
+    ~BTree() {
+        destroy(root);
+    }
+
+    // Builds a set of the distinct values in the tree
+    template <int N, typename Aggregator, typename Compare>
+    explicit BTree(const Tree<T, N, Aggregator, Compare>& tree) : root(nullptr), count(0), levels(0) {
+        for (const auto& node : tree.getNodesBFS()) {
+            insert(node->value);
+        }
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    // Number of levels, leaves included
+    size_t height() const {
+        return levels;
+    }
+
+    // Returns false if an equal key is already present. Full nodes are split on the way
+    // down, so the descent never has to climb back up.
+    bool insert(const T& value) {
+        if (!root) {
+            root = make_leaf();
+            levels = 1;
+        }
+        if (root->count == K - 1) {
+            Inner* top = make_inner();
+            top->children[0] = root;
+            split_child(top, 0);
+            root = top;
+            ++levels;
+        }
+
+        BNode* node = root;
+        while (!node->leaf) {
+            Inner* inner = static_cast<Inner*>(node);
+            int i = rank(inner, value);
+            if (inner->children[i]->count == K - 1) {
+                split_child(inner, i);
+                if (inner->keys[i] < value) ++i;
+            }
+            node = inner->children[i];
+        }
+
+        int pos = rank(node, value);
+        if (pos < node->count && !(value < node->keys[pos])) return false;
+        std::move_backward(node->keys + pos, node->keys + node->count, node->keys + node->count + 1);
+        node->keys[pos] = value;
+        ++node->count;
+        ++count;
+        return true;
+    }
+
+    const_iterator begin() const {
+        const BNode* node = root;
+        if (!node) return end();
+        while (!node->leaf) {
+            node = static_cast<const Inner*>(node)->children[0];
+        }
+        return const_iterator(static_cast<const Leaf*>(node), 0);
+    }
+
+    const_iterator end() const {
+        return const_iterator();
+    }
+
+    // First key not less than value
+    const_iterator lower_bound(const T& value) const {
+        std::pair<const Leaf*, int> at = locate(value);
+        return const_iterator(at.first, at.second);
+    }
+
+    const_iterator find(const T& value) const {
+        const_iterator it = lower_bound(value);
+        if (it == end() || value < *it) return end();
+        return it;
+    }
+
+    bool contains(const T& value) const {
+        return find(value) != end();
+    }
+
+    // Calls visitor(key) for every key in [low, high) in ascending order; returns the number visited.
+    // O(log_K n + m / (K - 1)) node visits for m keys.
+    template <typename Visitor>
+    size_t visit_range(const T& low, const T& high, Visitor visitor) const {
+        std::pair<const Leaf*, int> at = locate(low);
+        size_t visited = 0;
+        for (const Leaf* leaf = at.first; leaf; leaf = leaf->next) {
+            for (int i = at.second; i < leaf->count; ++i) {
+                if (!(leaf->keys[i] < high)) return visited;
+                visitor(leaf->keys[i]);
+                ++visited;
+            }
+            at.second = 0;
+        }
+        return visited;
+    }
+};
+
+#endif // BTREE_HPP
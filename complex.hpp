@@ -2,6 +2,7 @@
 #define COMPLEX_HPP
 
 #include <iostream>
+#include <functional>
 
 class Complex {
 public:
@@ -31,6 +32,29 @@ public:
         os << c.real << "+" << c.imag << "i";
         return os;
     }
+
+    // Squared magnitude, enough for ordering by |z| without a sqrt
+    double norm() const {
+        return real * real + imag * imag;
+    }
+};
+
+// Orders complex numbers by magnitude, e.g. Tree<Complex, 2, NoAggregate<Complex>, MagnitudeLess>
+struct MagnitudeLess {
+    bool operator()(const Complex& a, const Complex& b) const {
+        return a.norm() < b.norm();
+    }
+};
+
+// Hash consistent with operator==, for unordered containers and Tree::enable_value_filter
+namespace std {
+template <>
+struct hash<Complex> {
+    size_t operator()(const Complex& c) const {
+        size_t h = hash<double>()(c.real);
+        return h ^ (hash<double>()(c.imag) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2));
+    }
 };
+}
 
 #endif // COMPLEX_HPP
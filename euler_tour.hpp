@@ -0,0 +1,134 @@
+#ifndef EULER_TOUR_HPP
+#define EULER_TOUR_HPP
+
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <stdexcept>
+#include "node.hpp"
+
+// DFS entry/exit numbering of a tree. Node v gets entry index tin(v) in pre-order,
+// and its subtree occupies the contiguous range [tin(v), tin(v) + size(v)).
+template <typename T>
+class EulerTour {
+private:
+    std::vector<Node<T>*> order;
+    std::vector<size_t> sizes;
+    std::vector<size_t> parents;
+    std::vector<size_t> depths;
+    std::unordered_map<const Node<T>*, size_t> index;
+
+public:
+    static const size_t npos = static_cast<size_t>(-1);
+
+    EulerTour() {}
+
+    explicit EulerTour(std::shared_ptr<Node<T>> root) {
+        build(root);
+    }
+
+    // Linear rebuild: one pre-order pass to number nodes, one reverse pass to sum sizes
+    void build(std::shared_ptr<Node<T>> root) {
+        order.clear();
+        sizes.clear();
+        parents.clear();
+        depths.clear();
+        index.clear();
+        if (!root) return;
+
+        std::vector<std::pair<Node<T>*, size_t>> stack;
+        stack.push_back(std::make_pair(root.get(), npos));
+        while (!stack.empty()) {
+            Node<T>* node = stack.back().first;
+            size_t parent = stack.back().second;
+            stack.pop_back();
+            size_t id = order.size();
+            order.push_back(node);
+            parents.push_back(parent);
+            depths.push_back(parent == npos ? 0 : depths[parent] + 1);
+            index[node] = id;
+            for (auto it = node->children.rbegin(); it != node->children.rend(); ++it) {
+                if (!*it) continue;
+                stack.push_back(std::make_pair(it->get(), id));
+            }
+        }
+
+        sizes.assign(order.size(), 1);
+        for (size_t i = order.size(); i-- > 1;) {
+            sizes[parents[i]] += sizes[i];
+        }
+    }
+
+    size_t size() const {
+        return order.size();
+    }
+
+    bool contains(const Node<T>* node) const {
+        return index.count(node) != 0;
+    }
+
+    // Pre-order entry index of a node
+    size_t tin(const Node<T>* node) const {
+        auto it = index.find(node);
+        if (it == index.end()) {
+            throw std::out_of_range("EulerTour: node is not part of this tree");
+        }
+        return it->second;
+    }
+
+    // One past the last pre-order index of the node's subtree
+    size_t tout(const Node<T>* node) const {
+        size_t id = tin(node);
+        return id + sizes[id];
+    }
+
+    // True if a is b or an ancestor of b
+    bool is_ancestor(const Node<T>* a, const Node<T>* b) const {
+        size_t ia = tin(a);
+        size_t ib = tin(b);
+        return ia <= ib && ib < ia + sizes[ia];
+    }
+
+    size_t subtree_size(const Node<T>* node) const {
+        return sizes[tin(node)];
+    }
+
+    size_t depth(const Node<T>* node) const {
+        return depths[tin(node)];
+    }
+
+    // Node with the given pre-order index
+    Node<T>* at(size_t id) const {
+        return order[id];
+    }
+
+    size_t parent_of(size_t id) const {
+        return parents[id];
+    }
+
+    size_t depth_of(size_t id) const {
+        return depths[id];
+    }
+
+    size_t subtree_size_of(size_t id) const {
+        return sizes[id];
+    }
+
+    // The nodes of a subtree as a contiguous pre-order slice [first, last)
+    typename std::vector<Node<T>*>::const_iterator subtree_begin(const Node<T>* node) const {
+        return order.begin() + tin(node);
+    }
+
+    typename std::vector<Node<T>*>::const_iterator subtree_end(const Node<T>* node) const {
+        return order.begin() + tout(node);
+    }
+
+    const std::vector<Node<T>*>& nodes() const {
+        return order;
+    }
+};
+
+template <typename T>
+const size_t EulerTour<T>::npos;
+
+#endif // EULER_TOUR_HPP
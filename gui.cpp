@@ -44,6 +44,7 @@ void GUI::printTree(const Tree<double>& tree) {
             float child_x_spacing = 250.0f / (node->children.size() + 1);  // Slightly increased spacing for better separation
             for (size_t i = 0; i < node->children.size(); ++i) {
                 auto child = node->children[i];
+                if (!child) continue;  // Empty left slot of a binary search tree node
                 float x_offset = (i - (node->children.size() - 1) / 2.0f) * child_x_spacing;
                 positions[child] = sf::Vector2f(pos.x + x_offset, pos.y + level_height);
                 sf::Vertex line[] = {
@@ -123,6 +124,7 @@ void GUI::printTree(const Tree<double, 3>& tree) {
             float child_x_spacing = 250.0f / (node->children.size() + 1);  // Slightly increased spacing for better separation
             for (size_t i = 0; i < node->children.size(); ++i) {
                 auto child = node->children[i];
+                if (!child) continue;  // Empty left slot of a binary search tree node
                 float x_offset = (i - (node->children.size() - 1) / 2.0f) * child_x_spacing;
                 positions[child] = sf::Vector2f(pos.x + x_offset, pos.y + level_height);
                 sf::Vertex line[] = {
@@ -0,0 +1,15 @@
+#ifndef HASH_MIX_HPP
+#define HASH_MIX_HPP
+
+#include <cstdint>
+
+// splitmix64 finalizer: spreads every input bit over the whole word. Used on std::hash
+// results, which for integers are often the identity.
+inline uint64_t hash_mix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+#endif // HASH_MIX_HPP
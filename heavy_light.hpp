@@ -0,0 +1,149 @@
+#ifndef HEAVY_LIGHT_HPP
+#define HEAVY_LIGHT_HPP
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include "node.hpp"
+#include "tree.hpp"
+#include "parallel.hpp"
+#include "range_query.hpp"
+
+// Heavy-light decomposition of a tree for path aggregates and path updates.
+// Every node continues the chain of its largest child (the heavy one), so a path crosses
+// O(log n) chains. Nodes are numbered heavy child first, which makes every chain and every
+// subtree a contiguous range of one LazySegmentTree: path operations cost O(log^2 n),
+// subtree operations O(log n). Preprocessing is linear on top of the tree's Euler tour.
+// Like TraversalIndex, values are copied at build time and updates change only the copy.
+// Paths are combined chain by chain in no fixed direction, so Policy must be commutative.
+template <typename T, typename Policy = AddSum<T>>
+class HeavyLightIndex {
+public:
+    typedef typename Policy::value_type value_type;
+    typedef typename Policy::delta_type delta_type;
+    typedef std::pair<std::shared_ptr<Node<T>>, std::shared_ptr<Node<T>>> path_type;
+
+private:
+    EulerTour<T> tour;
+    // All indexed by Euler tour id
+    std::vector<size_t> head;
+    std::vector<size_t> position;
+    LazySegmentTree<Policy> segments;
+
+    // Calls f(first, last) for each position range that makes up the path between a and b
+    template <typename F>
+    void for_each_range(size_t a, size_t b, F f) const {
+        while (head[a] != head[b]) {
+            if (tour.depth_of(head[a]) < tour.depth_of(head[b])) std::swap(a, b);
+            f(position[head[a]], position[a] + 1);
+            a = tour.parent_of(head[a]);
+        }
+        if (position[a] > position[b]) std::swap(a, b);
+        f(position[a], position[b] + 1);
+    }
+
+public:
+    // Copies the tree's Euler tour; the index refers to nodes by address, so rebuild it after
+    // the tree changes structure
+    template <int K, typename Aggregator, typename Compare>
+    explicit HeavyLightIndex(const Tree<T, K, Aggregator, Compare>& tree) : tour(tree.euler_tour()) {
+        const size_t n = tour.size();
+        head.resize(n);
+        position.resize(n);
+
+        // Heavy child by Euler id: the child with the largest subtree, npos for leaves
+        std::vector<size_t> heavy(n, EulerTour<T>::npos);
+        for (size_t id = 1; id < n; ++id) {
+            size_t parent = tour.parent_of(id);
+            if (heavy[parent] == EulerTour<T>::npos || tour.subtree_size_of(id) > tour.subtree_size_of(heavy[parent])) {
+                heavy[parent] = id;
+            }
+        }
+
+        // Depth-first numbering that always takes the heavy child next
+        std::vector<value_type> values(n);
+        std::vector<size_t> stack;
+        if (n > 0) {
+            head[0] = 0;
+            stack.push_back(0);
+        }
+        size_t next = 0;
+        while (!stack.empty()) {
+            size_t id = stack.back();
+            stack.pop_back();
+            position[id] = next;
+            values[next] = tour.at(id)->value;
+            ++next;
+            // Children of id are the consecutive subtrees that follow it in the tour
+            for (size_t child = id + 1; child < id + tour.subtree_size_of(id); child += tour.subtree_size_of(child)) {
+                if (child == heavy[id]) continue;
+                head[child] = child;
+                stack.push_back(child);
+            }
+            if (heavy[id] != EulerTour<T>::npos) {
+                head[heavy[id]] = head[id];
+                stack.push_back(heavy[id]);
+            }
+        }
+        segments = LazySegmentTree<Policy>(values);
+    }
+
+    size_t size() const {
+        return position.size();
+    }
+
+    value_type value(std::shared_ptr<Node<T>> node) const {
+        size_t at = position[tour.tin(node.get())];
+        return segments.query(at, at + 1);
+    }
+
+    // Aggregate over every node on the path between a and b, both included
+    value_type path(std::shared_ptr<Node<T>> a, std::shared_ptr<Node<T>> b) const {
+        value_type result = Policy::identity();
+        for_each_range(tour.tin(a.get()), tour.tin(b.get()), [&](size_t first, size_t last) {
+            result = Policy::combine(result, segments.query(first, last));
+        });
+        return result;
+    }
+
+    // Aggregate from the root down to node
+    value_type root_path(std::shared_ptr<Node<T>> node) const {
+        value_type result = Policy::identity();
+        for_each_range(0, tour.tin(node.get()), [&](size_t first, size_t last) {
+            result = Policy::combine(result, segments.query(first, last));
+        });
+        return result;
+    }
+
+    // Applies delta to every node on the path between a and b, both included
+    void update_path(std::shared_ptr<Node<T>> a, std::shared_ptr<Node<T>> b, const delta_type& delta) {
+        for_each_range(tour.tin(a.get()), tour.tin(b.get()), [&](size_t first, size_t last) {
+            segments.update(first, last, delta);
+        });
+    }
+
+    value_type subtree(std::shared_ptr<Node<T>> node) const {
+        size_t id = tour.tin(node.get());
+        return segments.query(position[id], position[id] + tour.subtree_size_of(id));
+    }
+
+    void update_subtree(std::shared_ptr<Node<T>> node, const delta_type& delta) {
+        size_t id = tour.tin(node.get());
+        segments.update(position[id], position[id] + tour.subtree_size_of(id), delta);
+    }
+
+    // Answers a batch of path queries; queries never write, so large batches are split across threads
+    std::vector<value_type> path(const std::vector<path_type>& queries) const {
+        std::vector<value_type> results(queries.size());
+        parallel_for(queries.size(), size_t(1) << 12, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                results[i] = path(queries[i].first, queries[i].second);
+            }
+        });
+        return results;
+    }
+};
+
+#endif // HEAVY_LIGHT_HPP
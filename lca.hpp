@@ -0,0 +1,135 @@
+#ifndef LCA_HPP
+#define LCA_HPP
+
+#include <vector>
+#include <utility>
+#include <numeric>
+#include "euler_tour.hpp"
+
+// Lowest-common-ancestor index over an EulerTour.
+// For pre-order indices a < b, lca(a, b) is the parent of the shallowest node in (a, b],
+// so a sparse table over pre-order depths answers queries in O(1) after O(n log n) preprocessing.
+// The index keeps its own copy of the tour, so it stays valid when the tour it was built from
+// is rebuilt or destroyed, including the cached tour of a copied Tree.
+template <typename T>
+class LCAIndex {
+private:
+    EulerTour<T> tour;
+    // table[j][i] holds the pre-order index of the shallowest node in [i, i + 2^j)
+    std::vector<std::vector<size_t>> table;
+    std::vector<unsigned> log2;
+
+    size_t shallower(size_t a, size_t b) const {
+        return tour.depth_of(a) <= tour.depth_of(b) ? a : b;
+    }
+
+    size_t min_depth(size_t first, size_t last) const {
+        unsigned j = log2[last - first + 1];
+        return shallower(table[j][first], table[j][last + 1 - (size_t(1) << j)]);
+    }
+
+public:
+    LCAIndex() {}
+
+    explicit LCAIndex(const EulerTour<T>& tour) {
+        build(tour);
+    }
+
+    void build(const EulerTour<T>& source) {
+        tour = source;
+        size_t n = tour.size();
+        log2.assign(n + 1, 0);
+        for (size_t i = 2; i <= n; ++i) {
+            log2[i] = log2[i / 2] + 1;
+        }
+        table.assign(n ? log2[n] + 1 : 0, std::vector<size_t>());
+        if (n == 0) return;
+        table[0].resize(n);
+        std::iota(table[0].begin(), table[0].end(), size_t(0));
+        for (size_t j = 1; j < table.size(); ++j) {
+            size_t span = size_t(1) << j;
+            table[j].resize(n - span + 1);
+            for (size_t i = 0; i + span <= n; ++i) {
+                table[j][i] = shallower(table[j - 1][i], table[j - 1][i + span / 2]);
+            }
+        }
+    }
+
+    // LCA by pre-order index
+    size_t query(size_t a, size_t b) const {
+        if (a == b) return a;
+        if (a > b) std::swap(a, b);
+        return tour.parent_of(min_depth(a + 1, b));
+    }
+
+    Node<T>* query(const Node<T>* a, const Node<T>* b) const {
+        return tour.at(query(tour.tin(a), tour.tin(b)));
+    }
+
+    // Offline batch mode (Tarjan): answers all pairs in a single pre-order sweep with
+    // union-find, without building the sparse table.
+    static std::vector<Node<T>*> offline(const EulerTour<T>& tour,
+                                         const std::vector<std::pair<const Node<T>*, const Node<T>*>>& queries) {
+        size_t n = tour.size();
+        std::vector<Node<T>*> answers(queries.size(), nullptr);
+        if (n == 0) return answers;
+
+        // Queries bucketed by endpoint, as (other endpoint, query number)
+        std::vector<size_t> head(n, size_t(-1));
+        std::vector<size_t> next(2 * queries.size());
+        std::vector<size_t> other(2 * queries.size());
+        for (size_t q = 0; q < queries.size(); ++q) {
+            size_t a = tour.tin(queries[q].first);
+            size_t b = tour.tin(queries[q].second);
+            other[2 * q] = b;
+            next[2 * q] = head[a];
+            head[a] = 2 * q;
+            other[2 * q + 1] = a;
+            next[2 * q + 1] = head[b];
+            head[b] = 2 * q + 1;
+        }
+
+        std::vector<size_t> set(n), ancestor(n);
+        std::vector<bool> finished(n, false);
+        std::iota(set.begin(), set.end(), size_t(0));
+        std::iota(ancestor.begin(), ancestor.end(), size_t(0));
+        auto find = [&set](size_t x) {
+            while (set[x] != x) {
+                set[x] = set[set[x]];
+                x = set[x];
+            }
+            return x;
+        };
+
+        auto finish = [&](size_t v) {
+            finished[v] = true;
+            for (size_t e = head[v]; e != size_t(-1); e = next[e]) {
+                if (finished[other[e]]) {
+                    answers[e / 2] = tour.at(ancestor[find(other[e])]);
+                }
+            }
+            size_t p = tour.parent_of(v);
+            if (p != EulerTour<T>::npos) {
+                set[find(v)] = find(p);
+                ancestor[find(p)] = p;
+            }
+        };
+
+        // Nodes still open on the DFS path; a node finishes once the sweep leaves its range
+        std::vector<size_t> open;
+        for (size_t i = 0; i < n; ++i) {
+            while (!open.empty() && open.back() + tour.subtree_size_of(open.back()) <= i) {
+                finish(open.back());
+                open.pop_back();
+            }
+            open.push_back(i);
+        }
+        while (!open.empty()) {
+            finish(open.back());
+            open.pop_back();
+        }
+        return answers;
+    }
+};
+
+#endif // LCA_HPP
@@ -7,10 +7,16 @@
 template <typename T>
 class Node {
 public:
+    // Once the node is in a Tree, change it through Tree::set_value: a direct write, also
+    // through an iterator or visit, leaves the tree's summaries and value indexes stale
     T value;
     std::vector<std::shared_ptr<Node<T>>> children;
+    // Non-owning back link, set by Tree for every node it links in, including children of a
+    // Node passed to add_root or add_sub_node. Children pushed onto a node already in a tree
+    // are not linked until the tree rebuilds its shape (myHeap).
+    Node<T>* parent;
 
-    Node(const T& val) : value(val) {}
+    Node(const T& val) : value(val), parent(nullptr) {}
 
     T get_value() const {
         return value;
@@ -0,0 +1,140 @@
+#ifndef PAIRING_HEAP_HPP
+#define PAIRING_HEAP_HPP
+
+#include <memory>
+#include <vector>
+#include <stdexcept>
+#include <functional>
+#include "node.hpp"
+#include "tree.hpp"
+
+// Meldable heap built from Node<T> child lists; the top is the value that comes first under
+// Compare, as for Tree's heap mode, so the default std::less gives a min-heap.
+// Linking makes the later root the newest (last) child of the earlier one, so meld and
+// push are O(1) and pop is amortized O(log n) with the standard two-pass pairing.
+// Nodes may have any number of children, which is why this is not a Tree<T, K> mode.
+template <typename T, typename Compare = std::less<T>>
+class PairingHeap {
+private:
+    std::shared_ptr<Node<T>> root;
+    size_t count;
+    Compare compare;
+
+    std::shared_ptr<Node<T>> link(std::shared_ptr<Node<T>> a, std::shared_ptr<Node<T>> b) const {
+        if (!a) return b;
+        if (!b) return a;
+        if (compare(b->value, a->value)) std::swap(a, b);
+        b->parent = a.get();
+        a->children.push_back(b);
+        return a;
+    }
+
+public:
+    PairingHeap() : count(0) {}
+
+    explicit PairingHeap(Compare compare) : count(0), compare(compare) {}
+
+    PairingHeap(const PairingHeap&) = delete;
+    PairingHeap& operator=(const PairingHeap&) = delete;
+
+    PairingHeap(PairingHeap&& other) : root(other.root), count(other.count), compare(other.compare) {
+        other.root = nullptr;
+        other.count = 0;
+    }
+
+    // Pushing descending values builds an n-deep chain, so tear down iteratively
+    // instead of letting shared_ptr destructors recurse
+    ~PairingHeap() {
+        std::vector<std::shared_ptr<Node<T>>> pending;
+        if (root) pending.push_back(root);
+        root = nullptr;
+        while (!pending.empty()) {
+            std::shared_ptr<Node<T>> node = pending.back();
+            pending.pop_back();
+            for (auto& child : node->children) {
+                pending.push_back(child);
+            }
+            node->children.clear();
+        }
+    }
+
+    // Builds a heap holding a copy of every value in the tree, O(n). The tree's own Compare
+    // plays no part; the heap orders by compare.
+    template <int K, typename Aggregator, typename TreeCompare>
+    explicit PairingHeap(const Tree<T, K, Aggregator, TreeCompare>& tree, Compare compare = Compare())
+        : count(0), compare(compare) {
+        for (const auto& node : tree.getNodesBFS()) {
+            push(node->value);
+        }
+    }
+
+    std::shared_ptr<Node<T>> getRoot() const {
+        return root;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    std::shared_ptr<Node<T>> push(const T& value) {
+        std::shared_ptr<Node<T>> node = std::make_shared<Node<T>>(value);
+        root = link(root, node);
+        ++count;
+        return node;
+    }
+
+    const T& top() const {
+        if (!root) {
+            throw std::out_of_range("PairingHeap: heap is empty");
+        }
+        return root->value;
+    }
+
+    T pop() {
+        if (!root) {
+            throw std::out_of_range("PairingHeap: heap is empty");
+        }
+        T value = root->value;
+        std::vector<std::shared_ptr<Node<T>>> children;
+        children.swap(root->children);
+        for (const auto& child : children) {
+            child->parent = nullptr;
+        }
+
+        // First pass: link pairs starting from the newest child
+        std::vector<std::shared_ptr<Node<T>>> pairs;
+        pairs.reserve(children.size() / 2 + 1);
+        size_t i = children.size();
+        while (i >= 2) {
+            pairs.push_back(link(children[i - 1], children[i - 2]));
+            i -= 2;
+        }
+        if (i == 1) {
+            pairs.push_back(children[0]);
+        }
+
+        // Second pass: fold the pairs back from the last one formed
+        std::shared_ptr<Node<T>> merged;
+        for (auto it = pairs.rbegin(); it != pairs.rend(); ++it) {
+            merged = link(merged, *it);
+        }
+        root = merged;
+        --count;
+        return value;
+    }
+
+    // O(1): takes every node of other, leaving it empty
+    void meld(PairingHeap& other) {
+        if (this == &other) return;
+        root = link(root, other.root);
+        count += other.count;
+        other.root = nullptr;
+        other.count = 0;
+    }
+};
+
+#endif // PAIRING_HEAP_HPP
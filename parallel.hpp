@@ -0,0 +1,38 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <cstddef>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+// Number of chunks to split n items into, at least grain items per chunk
+inline size_t parallel_chunk_count(size_t n, size_t grain) {
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    return std::max<size_t>(1, std::min(threads, n / std::max<size_t>(1, grain)));
+}
+
+// Calls f(chunk, begin, end) for each of chunks contiguous slices of [0, n).
+// Chunk 0 runs on the calling thread; a single chunk never spawns a thread.
+template <typename F>
+void parallel_chunks(size_t n, size_t chunks, F f) {
+    size_t step = (n + chunks - 1) / std::max<size_t>(1, chunks);
+    std::vector<std::thread> workers;
+    for (size_t c = 1; c < chunks && c * step < n; ++c) {
+        workers.emplace_back(f, c, c * step, std::min(n, (c + 1) * step));
+    }
+    f(size_t(0), size_t(0), std::min(n, step));
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+// Calls f(begin, end) over [0, n) split across hardware threads, grain items minimum per thread
+template <typename F>
+void parallel_for(size_t n, size_t grain, F f) {
+    parallel_chunks(n, parallel_chunk_count(n, grain), [&f](size_t, size_t begin, size_t end) {
+        f(begin, end);
+    });
+}
+
+#endif // PARALLEL_HPP
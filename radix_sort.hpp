@@ -0,0 +1,119 @@
+#ifndef RADIX_SORT_HPP
+#define RADIX_SORT_HPP
+
+#include <cstring>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include "node.hpp"
+#include "parallel.hpp"
+
+// Order-preserving map from arithmetic values to unsigned integers, so that
+// a < b exactly when key(a) < key(b) (NaNs sort to the ends)
+template <typename T, typename Enable = void>
+struct RadixKey {
+    static const bool supported = false;
+};
+
+template <typename T>
+struct RadixKey<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type> {
+    static const bool supported = true;
+    typedef typename std::make_unsigned<T>::type type;
+
+    static type get(T value) {
+        type bits = static_cast<type>(value);
+        // Flipping the sign bit puts negative values first
+        return std::is_signed<T>::value ? type(bits ^ (type(1) << (8 * sizeof(T) - 1))) : bits;
+    }
+};
+
+template <typename T>
+struct RadixKey<T, typename std::enable_if<std::is_floating_point<T>::value && (sizeof(T) == 4 || sizeof(T) == 8)>::type> {
+    static const bool supported = true;
+    typedef typename std::conditional<sizeof(T) == 4, uint32_t, uint64_t>::type type;
+
+    static type get(T value) {
+        type bits;
+        std::memcpy(&bits, &value, sizeof(T));
+        const type sign = type(1) << (8 * sizeof(T) - 1);
+        // Negative floats reverse order, so flip all their bits; positives only gain the sign bit
+        return (bits & sign) ? type(~bits) : type(bits | sign);
+    }
+};
+
+// Stable LSD radix sort over 8-bit digits. Each pass histograms per thread slice, then every
+// slice scatters into its own precomputed offsets; passes where one digit holds every key are skipped.
+template <typename Item, typename KeyOf>
+void parallel_radix_sort(std::vector<Item>& items, KeyOf key_of) {
+    typedef decltype(key_of(items[0])) Key;
+    const size_t n = items.size();
+    if (n < 2) return;
+    const size_t chunks = parallel_chunk_count(n, size_t(1) << 16);
+    std::vector<Item> buffer(n);
+    std::vector<std::vector<size_t>> counts(chunks, std::vector<size_t>(256));
+
+    for (unsigned shift = 0; shift < 8 * sizeof(Key); shift += 8) {
+        parallel_chunks(n, chunks, [&](size_t chunk, size_t begin, size_t end) {
+            std::vector<size_t>& count = counts[chunk];
+            std::fill(count.begin(), count.end(), size_t(0));
+            for (size_t i = begin; i < end; ++i) {
+                ++count[(key_of(items[i]) >> shift) & 0xff];
+            }
+        });
+
+        // Turn the counts into per-slice starting offsets: digit-major, then slice order
+        size_t offset = 0;
+        bool trivial = false;
+        for (size_t digit = 0; digit < 256; ++digit) {
+            size_t digit_total = 0;
+            for (size_t chunk = 0; chunk < chunks; ++chunk) {
+                size_t count = counts[chunk][digit];
+                counts[chunk][digit] = offset;
+                offset += count;
+                digit_total += count;
+            }
+            trivial = trivial || digit_total == n;
+        }
+        if (trivial) continue;
+
+        parallel_chunks(n, chunks, [&](size_t chunk, size_t begin, size_t end) {
+            std::vector<size_t>& next = counts[chunk];
+            for (size_t i = begin; i < end; ++i) {
+                buffer[next[(key_of(items[i]) >> shift) & 0xff]++] = items[i];
+            }
+        });
+        items.swap(buffer);
+    }
+}
+
+template <typename T>
+void sort_nodes_by_value(std::vector<Node<T>*>& nodes, std::true_type) {
+    typedef typename RadixKey<T>::type Key;
+    std::vector<std::pair<Key, Node<T>*>> items(nodes.size());
+    parallel_for(nodes.size(), size_t(1) << 16, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            items[i] = std::make_pair(RadixKey<T>::get(nodes[i]->value), nodes[i]);
+        }
+    });
+    parallel_radix_sort(items, [](const std::pair<Key, Node<T>*>& item) { return item.first; });
+    for (size_t i = 0; i < items.size(); ++i) {
+        nodes[i] = items[i].second;
+    }
+}
+
+template <typename T>
+void sort_nodes_by_value(std::vector<Node<T>*>& nodes, std::false_type) {
+    std::stable_sort(nodes.begin(), nodes.end(), [](const Node<T>* a, const Node<T>* b) {
+        return a->value < b->value;
+    });
+}
+
+// Stable ascending sort of nodes by value: radix sort for integers and double/float,
+// std::stable_sort on operator< for everything else
+template <typename T>
+void sort_nodes_by_value(std::vector<Node<T>*>& nodes) {
+    sort_nodes_by_value(nodes, std::integral_constant<bool, RadixKey<T>::supported>());
+}
+
+#endif // RADIX_SORT_HPP
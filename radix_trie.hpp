@@ -0,0 +1,251 @@
+#ifndef RADIX_TRIE_HPP
+#define RADIX_TRIE_HPP
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include "node.hpp"
+#include "tree.hpp"
+
+// Set of strings stored as a path-compressed radix trie. Every edge carries a whole substring,
+// so a chain of single-child nodes collapses into one node and keys share their common prefixes.
+// Lookup, insert and prefix search walk at most |key| characters; each child slot stores the
+// first byte of its edge next to the pointer, so choosing an edge scans one short array instead
+// of dereferencing every child.
+// This is its own class rather than a Tree<std::string> mode because a trie node needs an
+// end-of-key flag and children keyed by first byte, neither of which Node has.
+class RadixTrie {
+private:
+    struct TrieNode;
+
+    struct Child {
+        char first;
+        std::unique_ptr<TrieNode> node;
+    };
+
+    struct TrieNode {
+        std::string edge;
+        std::vector<Child> children;
+        bool terminal;
+
+        TrieNode(const std::string& edge, bool terminal) : edge(edge), terminal(terminal) {}
+    };
+
+    std::unique_ptr<TrieNode> root;
+    size_t count;
+
+    // Index of the child whose edge starts with c, or std::string::npos
+    static size_t find_child(const TrieNode* node, char c) {
+        for (size_t i = 0; i < node->children.size(); ++i) {
+            if (node->children[i].first == c) return i;
+        }
+        return std::string::npos;
+    }
+
+    // Children stay sorted by first byte so enumeration comes out in lexicographic order
+    static void add_child(TrieNode* node, std::unique_ptr<TrieNode> child) {
+        Child slot;
+        slot.first = child->edge[0];
+        slot.node = std::move(child);
+        size_t i = 0;
+        while (i < node->children.size() &&
+               static_cast<unsigned char>(node->children[i].first) < static_cast<unsigned char>(slot.first)) {
+            ++i;
+        }
+        node->children.insert(node->children.begin() + i, std::move(slot));
+    }
+
+    // Heap bytes a string of this length needs beyond its inline buffer, 0 when the small-string buffer holds it
+    static size_t string_heap_bytes(const std::string& s) {
+        return s.size() > std::string().capacity() ? s.size() + 1 : 0;
+    }
+
+    // Node whose subtree holds exactly the keys starting with prefix, or nullptr; path receives
+    // the full string spelled by that node, which may run past prefix when it ends inside an edge
+    const TrieNode* locate_prefix(const std::string& prefix, std::string& path) const {
+        const TrieNode* node = root.get();
+        path.clear();
+        size_t pos = 0;
+        while (pos < prefix.size()) {
+            size_t i = find_child(node, prefix[pos]);
+            if (i == std::string::npos) return nullptr;
+            node = node->children[i].node.get();
+            size_t length = std::min(node->edge.size(), prefix.size() - pos);
+            if (node->edge.compare(0, length, prefix, pos, length) != 0) return nullptr;
+            path += node->edge;
+            pos += node->edge.size();
+        }
+        return node;
+    }
+
+public:
+    RadixTrie() : root(new TrieNode(std::string(), false)), count(0) {}
+
+    // Builds a trie of the distinct labels in the tree
+    template <int K, typename Aggregator, typename Compare>
+    explicit RadixTrie(const Tree<std::string, K, Aggregator, Compare>& tree) : root(new TrieNode(std::string(), false)), count(0) {
+        for (const auto& node : tree.getNodesBFS()) {
+            insert(node->value);
+        }
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    // Returns false if the key was already present. Splits at most one edge.
+    bool insert(const std::string& key) {
+        TrieNode* node = root.get();
+        size_t pos = 0;
+        while (pos < key.size()) {
+            size_t i = find_child(node, key[pos]);
+            if (i == std::string::npos) {
+                add_child(node, std::unique_ptr<TrieNode>(new TrieNode(key.substr(pos), true)));
+                ++count;
+                return true;
+            }
+
+            TrieNode* child = node->children[i].node.get();
+            size_t common = 1;
+            while (common < child->edge.size() && pos + common < key.size() && child->edge[common] == key[pos + common]) {
+                ++common;
+            }
+            if (common < child->edge.size()) {
+                // Key diverges inside the edge: split it, the shared part becomes a new inner node
+                std::unique_ptr<TrieNode> middle(new TrieNode(child->edge.substr(0, common), false));
+                std::unique_ptr<TrieNode> tail = std::move(node->children[i].node);
+                tail->edge.erase(0, common);
+                add_child(middle.get(), std::move(tail));
+                node->children[i].node = std::move(middle);
+                child = node->children[i].node.get();
+            }
+            node = child;
+            pos += common;
+        }
+        if (node->terminal) return false;
+        node->terminal = true;
+        ++count;
+        return true;
+    }
+
+    // O(|key|)
+    bool contains(const std::string& key) const {
+        const TrieNode* node = root.get();
+        size_t pos = 0;
+        while (pos < key.size()) {
+            size_t i = find_child(node, key[pos]);
+            if (i == std::string::npos) return false;
+            node = node->children[i].node.get();
+            if (key.compare(pos, node->edge.size(), node->edge) != 0) return false;
+            pos += node->edge.size();
+        }
+        return node->terminal;
+    }
+
+    // Length of the longest stored key that is a prefix of query, or std::string::npos if there is none
+    size_t longest_prefix(const std::string& query) const {
+        const TrieNode* node = root.get();
+        size_t pos = 0;
+        size_t best = node->terminal ? 0 : std::string::npos;
+        while (pos < query.size()) {
+            size_t i = find_child(node, query[pos]);
+            if (i == std::string::npos) break;
+            const TrieNode* child = node->children[i].node.get();
+            if (query.compare(pos, child->edge.size(), child->edge) != 0) break;
+            node = child;
+            pos += child->edge.size();
+            if (node->terminal) best = pos;
+        }
+        return best;
+    }
+
+    // Calls visitor(key) for every stored key starting with prefix, in lexicographic byte order;
+    // returns the number of keys visited
+    template <typename Visitor>
+    size_t visit_prefix(const std::string& prefix, Visitor visitor) const {
+        std::string path;
+        const TrieNode* start = locate_prefix(prefix, path);
+        if (!start) return 0;
+
+        size_t visited = 0;
+        std::vector<std::pair<const TrieNode*, size_t>> stack;
+        stack.push_back(std::make_pair(start, path.size()));
+        bool first = true;
+        while (!stack.empty()) {
+            const TrieNode* node = stack.back().first;
+            size_t length = stack.back().second;
+            stack.pop_back();
+            if (!first) {
+                path.resize(length);
+                path += node->edge;
+            }
+            first = false;
+            if (node->terminal) {
+                visitor(path);
+                ++visited;
+            }
+            for (size_t i = node->children.size(); i-- > 0;) {
+                stack.push_back(std::make_pair(node->children[i].node.get(), path.size()));
+            }
+        }
+        return visited;
+    }
+
+    std::vector<std::string> keys_with_prefix(const std::string& prefix) const {
+        std::vector<std::string> keys;
+        visit_prefix(prefix, [&keys](const std::string& key) { keys.push_back(key); });
+        return keys;
+    }
+
+    // Trie nodes, the root included
+    size_t node_count() const {
+        size_t nodes = 0;
+        std::vector<const TrieNode*> stack(1, root.get());
+        while (!stack.empty()) {
+            const TrieNode* node = stack.back();
+            stack.pop_back();
+            ++nodes;
+            for (const auto& child : node->children) {
+                stack.push_back(child.node.get());
+            }
+        }
+        return nodes;
+    }
+
+    // Approximate bytes held by the trie: node objects plus edge and child-array heap storage
+    size_t memory_bytes() const {
+        size_t bytes = 0;
+        std::vector<const TrieNode*> stack(1, root.get());
+        while (!stack.empty()) {
+            const TrieNode* node = stack.back();
+            stack.pop_back();
+            bytes += sizeof(TrieNode) + string_heap_bytes(node->edge) + node->children.capacity() * sizeof(Child);
+            for (const auto& child : node->children) {
+                stack.push_back(child.node.get());
+            }
+        }
+        return bytes;
+    }
+
+    // Approximate bytes the same keys take as one make_shared Node<std::string> per key,
+    // each referenced from one parent child slot
+    size_t node_memory_bytes() const {
+        // make_shared stores the use and weak counts plus a vtable pointer next to the object
+        const size_t control_block = 2 * sizeof(long) + sizeof(void*);
+        size_t bytes = 0;
+        visit_prefix(std::string(), [&](const std::string& key) {
+            bytes += control_block + sizeof(Node<std::string>) + sizeof(std::shared_ptr<Node<std::string>>);
+            bytes += string_heap_bytes(key);
+        });
+        return bytes;
+    }
+};
+
+#endif // RADIX_TRIE_HPP
@@ -0,0 +1,380 @@
+#ifndef RANGE_QUERY_HPP
+#define RANGE_QUERY_HPP
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+#include "node.hpp"
+#include "tree.hpp"
+
+// Monoid policies for SegmentTree and TraversalIndex:
+//   value_type          the combined value
+//   identity()          neutral element, combine(identity(), x) == x
+//   combine(a, b)       associative; a covers the earlier positions, so it need not commute
+
+template <typename T>
+struct SumMonoid {
+    typedef T value_type;
+
+    static T identity() {
+        return T();
+    }
+
+    static T combine(const T& a, const T& b) {
+        return a + b;
+    }
+};
+
+// MinMonoid and MaxMonoid take their identity from std::numeric_limits. Without a
+// specialization that would silently be T(), so other types such as std::string do not
+// compile and need a monoid with its own identity.
+template <typename T>
+struct MinMonoid {
+    static_assert(std::numeric_limits<T>::is_specialized, "MinMonoid needs std::numeric_limits<T> for its identity");
+    typedef T value_type;
+
+    static T identity() {
+        return std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+    }
+
+    static T combine(const T& a, const T& b) {
+        return b < a ? b : a;
+    }
+};
+
+template <typename T>
+struct MaxMonoid {
+    static_assert(std::numeric_limits<T>::is_specialized, "MaxMonoid needs std::numeric_limits<T> for its identity");
+    typedef T value_type;
+
+    static T identity() {
+        return std::numeric_limits<T>::has_infinity ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::lowest();
+    }
+
+    static T combine(const T& a, const T& b) {
+        return a < b ? b : a;
+    }
+};
+
+// Bottom-up segment tree over n values stored in one 2n array: leaves at [n, 2n), node i
+// combines 2i and 2i + 1. Point update and range query are O(log n), build is O(n).
+template <typename Monoid>
+class SegmentTree {
+public:
+    typedef typename Monoid::value_type value_type;
+
+private:
+    size_t n;
+    std::vector<value_type> data;
+
+public:
+    SegmentTree() : n(0) {}
+
+    explicit SegmentTree(const std::vector<value_type>& values) {
+        build(values);
+    }
+
+    void build(const std::vector<value_type>& values) {
+        n = values.size();
+        data.assign(2 * n, Monoid::identity());
+        std::copy(values.begin(), values.end(), data.begin() + n);
+        for (size_t i = n; i-- > 1;) {
+            data[i] = Monoid::combine(data[2 * i], data[2 * i + 1]);
+        }
+    }
+
+    size_t size() const {
+        return n;
+    }
+
+    const value_type& get(size_t i) const {
+        return data[n + i];
+    }
+
+    void set(size_t i, const value_type& value) {
+        i += n;
+        data[i] = value;
+        for (i >>= 1; i > 0; i >>= 1) {
+            data[i] = Monoid::combine(data[2 * i], data[2 * i + 1]);
+        }
+    }
+
+    // Combination of positions [first, last) in order; identity() for an empty range.
+    // Left and right partial results are kept apart so non-commutative monoids come out in order.
+    value_type query(size_t first, size_t last) const {
+        value_type left = Monoid::identity();
+        value_type right = Monoid::identity();
+        for (first += n, last += n; first < last; first >>= 1, last >>= 1) {
+            if (first & 1) left = Monoid::combine(left, data[first++]);
+            if (last & 1) right = Monoid::combine(data[--last], right);
+        }
+        return Monoid::combine(left, right);
+    }
+};
+
+// Range-update policies for LazySegmentTree: a monoid plus a delta applied to whole ranges
+//   value_type, identity(), combine(a, b)   as for the monoids above
+//   delta_type, no_change()                 the update and its neutral element
+//   apply(value, delta, length)             summary of length positions after each receives delta
+//   compose(first, then)                    one delta equivalent to first followed by then
+// apply must distribute over combine, which holds for adding to sums, minima and maxima.
+
+template <typename T>
+struct AddSum : SumMonoid<T> {
+    typedef T delta_type;
+
+    static T no_change() {
+        return T();
+    }
+
+    static T apply(const T& value, const T& delta, size_t length) {
+        return value + delta * T(length);
+    }
+
+    static T compose(const T& first, const T& then) {
+        return first + then;
+    }
+};
+
+template <typename T>
+struct AddMin : MinMonoid<T> {
+    typedef T delta_type;
+
+    static T no_change() {
+        return T();
+    }
+
+    static T apply(const T& value, const T& delta, size_t) {
+        return value + delta;
+    }
+
+    static T compose(const T& first, const T& then) {
+        return first + then;
+    }
+};
+
+template <typename T>
+struct AddMax : MaxMonoid<T> {
+    typedef T delta_type;
+
+    static T no_change() {
+        return T();
+    }
+
+    static T apply(const T& value, const T& delta, size_t) {
+        return value + delta;
+    }
+
+    static T compose(const T& first, const T& then) {
+        return first + then;
+    }
+};
+
+// Segment tree with range update and range query, both O(log n).
+// Pending deltas are never pushed down: a node's summary already includes its own delta and
+// queries reapply the deltas of partially covered ancestors on the way back up. Queries
+// therefore do not write, so concurrent queries are safe while no update runs.
+template <typename Policy>
+class LazySegmentTree {
+public:
+    typedef typename Policy::value_type value_type;
+    typedef typename Policy::delta_type delta_type;
+
+private:
+    size_t n;
+    std::vector<value_type> data;
+    std::vector<delta_type> pending;
+
+    void build(size_t node, size_t low, size_t high, const std::vector<value_type>& values) {
+        if (high - low == 1) {
+            data[node] = values[low];
+            return;
+        }
+        size_t mid = low + (high - low) / 2;
+        build(2 * node, low, mid, values);
+        build(2 * node + 1, mid, high, values);
+        data[node] = Policy::combine(data[2 * node], data[2 * node + 1]);
+    }
+
+    void update(size_t node, size_t low, size_t high, size_t first, size_t last, const delta_type& delta) {
+        if (last <= low || high <= first) return;
+        if (first <= low && high <= last) {
+            data[node] = Policy::apply(data[node], delta, high - low);
+            pending[node] = Policy::compose(pending[node], delta);
+            return;
+        }
+        size_t mid = low + (high - low) / 2;
+        update(2 * node, low, mid, first, last, delta);
+        update(2 * node + 1, mid, high, first, last, delta);
+        data[node] = Policy::apply(Policy::combine(data[2 * node], data[2 * node + 1]), pending[node], high - low);
+    }
+
+    value_type query(size_t node, size_t low, size_t high, size_t first, size_t last) const {
+        if (last <= low || high <= first) return Policy::identity();
+        if (first <= low && high <= last) return data[node];
+        size_t mid = low + (high - low) / 2;
+        value_type inside = Policy::combine(query(2 * node, low, mid, first, last),
+                                            query(2 * node + 1, mid, high, first, last));
+        size_t covered = std::min(high, last) - std::max(low, first);
+        return Policy::apply(inside, pending[node], covered);
+    }
+
+public:
+    LazySegmentTree() : n(0) {}
+
+    explicit LazySegmentTree(const std::vector<value_type>& values) : n(values.size()) {
+        data.assign(4 * std::max<size_t>(1, n), Policy::identity());
+        pending.assign(data.size(), Policy::no_change());
+        if (n > 0) build(1, 0, n, values);
+    }
+
+    size_t size() const {
+        return n;
+    }
+
+    // Applies delta to every position in [first, last)
+    void update(size_t first, size_t last, const delta_type& delta) {
+        if (first < last) update(1, 0, n, first, last, delta);
+    }
+
+    // Combination of positions [first, last); identity() for an empty range
+    value_type query(size_t first, size_t last) const {
+        if (first >= last) return Policy::identity();
+        return query(1, 0, n, first, last);
+    }
+};
+
+// Fenwick (binary indexed) tree of prefix sums: half the memory of SegmentTree, but the
+// operation must be invertible, so T needs + and -. Point add and range sum are O(log n).
+template <typename T>
+class FenwickTree {
+private:
+    std::vector<T> data;
+
+public:
+    FenwickTree() {}
+
+    // O(n) build: each slot pushes its partial sum to the next slot that covers it
+    explicit FenwickTree(const std::vector<T>& values) : data(values) {
+        for (size_t i = 1; i <= data.size(); ++i) {
+            size_t next = i + (i & (~i + 1));
+            if (next <= data.size()) data[next - 1] = data[next - 1] + data[i - 1];
+        }
+    }
+
+    size_t size() const {
+        return data.size();
+    }
+
+    void add(size_t i, const T& delta) {
+        for (++i; i <= data.size(); i += i & (~i + 1)) {
+            data[i - 1] = data[i - 1] + delta;
+        }
+    }
+
+    // Sum of positions [0, last)
+    T prefix(size_t last) const {
+        T sum = T();
+        for (; last > 0; last -= last & (~last + 1)) {
+            sum = sum + data[last - 1];
+        }
+        return sum;
+    }
+
+    // Sum of positions [first, last)
+    T query(size_t first, size_t last) const {
+        return prefix(last) - prefix(first);
+    }
+};
+
+// Range queries over the pre-order or BFS sequence of a tree. Values are copied from the nodes
+// when the index is built; update() changes the indexed copy and leaves the tree untouched.
+// In pre-order every subtree is a contiguous range, so subtree() answers in O(log n) too.
+// The index refers to the nodes by address and must be rebuilt after structural changes.
+template <typename T, typename Monoid = SumMonoid<T>>
+class TraversalIndex {
+public:
+    typedef typename Monoid::value_type value_type;
+
+private:
+    std::vector<Node<T>*> order;
+    std::vector<size_t> sizes;
+    std::unordered_map<const Node<T>*, size_t> index;
+    SegmentTree<Monoid> segments;
+
+    void build_segments() {
+        std::vector<value_type> values;
+        values.reserve(order.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            index[order[i]] = i;
+            values.push_back(order[i]->value);
+        }
+        segments.build(values);
+    }
+
+public:
+    // Pre-order positions, taken from the tree's cached Euler tour
+    template <int K, typename Aggregator, typename Compare>
+    TraversalIndex(const Tree<T, K, Aggregator, Compare>& tree, PreOrder) {
+        const EulerTour<T>& tour = tree.euler_tour();
+        order = tour.nodes();
+        sizes.resize(order.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            sizes[i] = tour.subtree_size_of(i);
+        }
+        build_segments();
+    }
+
+    // BFS positions; subtree() is not available in this order
+    template <int K, typename Aggregator, typename Compare>
+    TraversalIndex(const Tree<T, K, Aggregator, Compare>& tree, BFSOrder) {
+        for (const auto& node : tree.getNodesBFS()) {
+            order.push_back(node.get());
+        }
+        build_segments();
+    }
+
+    size_t size() const {
+        return order.size();
+    }
+
+    size_t position(const Node<T>* node) const {
+        auto it = index.find(node);
+        if (it == index.end()) {
+            throw std::out_of_range("TraversalIndex: node is not part of this index");
+        }
+        return it->second;
+    }
+
+    Node<T>* node_at(size_t i) const {
+        return order[i];
+    }
+
+    const value_type& value(std::shared_ptr<Node<T>> node) const {
+        return segments.get(position(node.get()));
+    }
+
+    void update(std::shared_ptr<Node<T>> node, const value_type& value) {
+        segments.set(position(node.get()), value);
+    }
+
+    // Combination over traversal positions [first, last)
+    value_type query(size_t first, size_t last) const {
+        return segments.query(first, std::min(last, order.size()));
+    }
+
+    // Combination over the subtree rooted at node; pre-order indexes only
+    value_type subtree(std::shared_ptr<Node<T>> node) const {
+        if (sizes.empty() && !order.empty()) {
+            throw std::logic_error("TraversalIndex: subtree queries need a pre-order index");
+        }
+        size_t first = position(node.get());
+        return segments.query(first, first + sizes[first]);
+    }
+};
+
+#endif // RANGE_QUERY_HPP
@@ -3,6 +3,12 @@
 #include "tree.hpp"
 #include "node.hpp"
 #include "complex.hpp"
+#include "pairing_heap.hpp"
+#include "btree.hpp"
+#include "radix_trie.hpp"
+#include "range_query.hpp"
+#include "heavy_light.hpp"
+#include "bloom_filter.hpp"
 
 // Helper function to create a basic tree of integers
 Tree<int> createBasicIntTree() {
@@ -341,3 +347,1376 @@ TEST_CASE("Tree with Complex numbers") {
         }));
     }
 }
+
+TEST_CASE("Subtree-rooted traversal") {
+    Tree<int> tree = createBasicIntTree();
+    auto sub = tree.getRoot()->children[0];
+
+    SUBCASE("Pre-order traversal of a subtree") {
+        std::vector<int> expected = {2, 4, 5};
+        std::vector<int> result;
+        for (auto node = tree.begin_pre_order(sub); node != tree.end_pre_order(); ++node) {
+            result.push_back((*node).get_value());
+        }
+        CHECK(result == expected);
+    }
+
+    SUBCASE("Post-order traversal of a subtree") {
+        std::vector<int> expected = {4, 5, 2};
+        std::vector<int> result;
+        for (auto node = tree.begin_post_order(sub); node != tree.end_post_order(); ++node) {
+            result.push_back((*node).get_value());
+        }
+        CHECK(result == expected);
+    }
+
+    SUBCASE("In-order traversal of a subtree") {
+        std::vector<int> expected = {4, 2, 5};
+        std::vector<int> result;
+        for (auto node = tree.begin_in_order(sub); node != tree.end_in_order(); ++node) {
+            result.push_back((*node).get_value());
+        }
+        CHECK(result == expected);
+    }
+
+    SUBCASE("BFS and DFS traversal of a subtree") {
+        std::vector<int> bfs, dfs;
+        for (auto node = tree.begin_bfs_scan(sub); node != tree.end_bfs_scan(); ++node) {
+            bfs.push_back((*node).get_value());
+        }
+        for (auto node = tree.begin_dfs_scan(sub); node != tree.end_dfs_scan(); ++node) {
+            dfs.push_back((*node).get_value());
+        }
+        CHECK(bfs == std::vector<int>({2, 4, 5}));
+        CHECK(dfs == std::vector<int>({2, 4, 5}));
+    }
+
+    SUBCASE("Heap traversal of a subtree") {
+        std::vector<int> result;
+        for (auto node = tree.begin_heap(sub); node != tree.end_heap(); ++node) {
+            result.push_back((*node).get_value());
+        }
+        CHECK(result.size() == 3);
+        CHECK(result[0] == 2);
+        CHECK(std::is_heap(result.begin(), result.end(), std::greater<int>()));
+    }
+}
+
+TEST_CASE("Pruned traversal with skip_subtree") {
+    Tree<int> tree = createBasicIntTree();
+
+    SUBCASE("Pre-order skips pruned subtrees") {
+        // Prune every subtree whose root is odd (except the root itself)
+        std::vector<int> visited;
+        for (auto node = tree.begin_pre_order(); node != tree.end_pre_order();) {
+            int value = (*node).get_value();
+            visited.push_back(value);
+            if (value != 1 && value % 2 == 1) {
+                node.skip_subtree();
+            } else {
+                ++node;
+            }
+        }
+        CHECK(visited == std::vector<int>({1, 2, 4, 5, 3}));
+    }
+
+    SUBCASE("Visited-node reduction on a selective predicate") {
+        // Only the subtree under 3 is relevant; 2's subtree is never touched
+        size_t full = 0, pruned = 0;
+        for (auto node = tree.begin_dfs_scan(); node != tree.end_dfs_scan(); ++node) {
+            ++full;
+        }
+        for (auto node = tree.begin_dfs_scan(); node != tree.end_dfs_scan();) {
+            ++pruned;
+            if ((*node).get_value() == 2) {
+                node.skip_subtree();
+            } else {
+                ++node;
+            }
+        }
+        CHECK(full == 6);
+        CHECK(pruned == 4);
+    }
+
+    SUBCASE("BFS skips pruned subtrees") {
+        std::vector<int> visited;
+        for (auto node = tree.begin_bfs_scan(); node != tree.end_bfs_scan();) {
+            visited.push_back((*node).get_value());
+            if ((*node).get_value() == 3) {
+                node.skip_subtree();
+            } else {
+                ++node;
+            }
+        }
+        CHECK(visited == std::vector<int>({1, 2, 3, 4, 5}));
+    }
+}
+
+TEST_CASE("Internal-iteration visit") {
+    Tree<int> tree = createBasicIntTree();
+
+    auto collect = [&tree](std::vector<int>& out) {
+        return [&out](Node<int>& node) { out.push_back(node.get_value()); };
+    };
+
+    SUBCASE("Every order matches its iterator") {
+        std::vector<int> pre, post, in, bfs, dfs;
+        tree.visit<PreOrder>(collect(pre));
+        tree.visit<PostOrder>(collect(post));
+        tree.visit<InOrder>(collect(in));
+        tree.visit<BFSOrder>(collect(bfs));
+        tree.visit<DFSOrder>(collect(dfs));
+        CHECK(pre == std::vector<int>({1, 2, 4, 5, 3, 6}));
+        CHECK(post == std::vector<int>({4, 5, 2, 6, 3, 1}));
+        CHECK(in == std::vector<int>({4, 2, 5, 1, 6, 3}));
+        CHECK(bfs == std::vector<int>({1, 2, 3, 4, 5, 6}));
+        CHECK(dfs == std::vector<int>({1, 2, 4, 5, 3, 6}));
+    }
+
+    SUBCASE("Heap order") {
+        std::vector<int> heap;
+        tree.visit<HeapOrder>(collect(heap));
+        CHECK(heap.size() == 6);
+        CHECK(std::is_heap(heap.begin(), heap.end(), std::greater<int>()));
+    }
+
+    SUBCASE("Subtree visit") {
+        std::vector<int> post;
+        tree.visit<PostOrder>(tree.getRoot()->children[1], collect(post));
+        CHECK(post == std::vector<int>({6, 3}));
+    }
+
+    SUBCASE("Nested visits on the same tree") {
+        const Tree<int>& view = tree;
+        std::vector<int> outer;
+        size_t inner = 0;
+        view.visit<PostOrder>([&](Node<int>& node) {
+            outer.push_back(node.get_value());
+            view.visit<PostOrder>([&inner](Node<int>&) { ++inner; });
+            view.visit<PreOrder>([&inner](Node<int>&) { ++inner; });
+            inner += view.top_k(2).size();
+        });
+        CHECK(outer == std::vector<int>({4, 5, 2, 6, 3, 1}));
+        CHECK(inner == 6 * (6 + 6 + 2));
+    }
+
+    SUBCASE("Empty tree") {
+        Tree<int> empty;
+        int count = 0;
+        empty.visit<PreOrder>([&count](Node<int>&) { ++count; });
+        CHECK(count == 0);
+    }
+}
+
+TEST_CASE("Euler tour ancestor and subtree queries") {
+    Tree<int> tree = createBasicIntTree();
+    auto root = tree.getRoot();
+    auto n2 = root->children[0];
+    auto n3 = root->children[1];
+    auto n4 = n2->children[0];
+    auto n6 = n3->children[0];
+
+    SUBCASE("Ancestor queries") {
+        CHECK(tree.is_ancestor(root, n6));
+        CHECK(tree.is_ancestor(n2, n4));
+        CHECK(tree.is_ancestor(n2, n2));
+        CHECK(!tree.is_ancestor(n2, n6));
+        CHECK(!tree.is_ancestor(n4, n2));
+    }
+
+    SUBCASE("Subtree sizes and slices") {
+        CHECK(tree.subtree_size(root) == 6);
+        CHECK(tree.subtree_size(n2) == 3);
+        CHECK(tree.subtree_size(n6) == 1);
+        const EulerTour<int>& tour = tree.euler_tour();
+        std::vector<int> slice;
+        for (auto it = tour.subtree_begin(n2.get()); it != tour.subtree_end(n2.get()); ++it) {
+            slice.push_back((*it)->get_value());
+        }
+        CHECK(slice == std::vector<int>({2, 4, 5}));
+        CHECK(tour.depth(n4.get()) == 2);
+    }
+
+    SUBCASE("Index is rebuilt after a mutation") {
+        CHECK(tree.subtree_size(n3) == 2);
+        tree.add_sub_node(Node<int>(3), Node<int>(7));
+        CHECK(tree.subtree_size(n3) == 3);
+        CHECK(tree.is_ancestor(n3, n3->children[1]));
+    }
+
+    SUBCASE("Unknown nodes are rejected") {
+        auto stranger = std::make_shared<Node<int>>(42);
+        CHECK_THROWS_AS(tree.subtree_size(stranger), std::out_of_range);
+    }
+}
+
+TEST_CASE("Lowest common ancestor queries") {
+    Tree<int> tree = createBasicIntTree();
+    auto root = tree.getRoot();
+    auto n2 = root->children[0];
+    auto n3 = root->children[1];
+    auto n4 = n2->children[0];
+    auto n5 = n2->children[1];
+    auto n6 = n3->children[0];
+
+    SUBCASE("Single queries") {
+        CHECK(tree.lca(n4, n5) == n2.get());
+        CHECK(tree.lca(n4, n6) == root.get());
+        CHECK(tree.lca(n2, n5) == n2.get());
+        CHECK(tree.lca(n6, n6) == n6.get());
+        CHECK(tree.lca(root, n4) == root.get());
+    }
+
+    SUBCASE("Offline batch matches single queries") {
+        std::vector<std::shared_ptr<Node<int>>> all = tree.getNodesBFS();
+        std::vector<std::pair<std::shared_ptr<Node<int>>, std::shared_ptr<Node<int>>>> queries;
+        for (const auto& a : all) {
+            for (const auto& b : all) {
+                queries.push_back(std::make_pair(a, b));
+            }
+        }
+        std::vector<Node<int>*> answers = tree.lca(queries);
+        REQUIRE(answers.size() == queries.size());
+        for (size_t i = 0; i < queries.size(); ++i) {
+            CHECK(answers[i] == tree.lca(queries[i].first, queries[i].second));
+        }
+    }
+
+    SUBCASE("A copy keeps its own index while the source is rebuilt") {
+        CHECK(tree.lca(n4, n6) == root.get());
+        Tree<int> copy = tree;
+        for (int value = 7; value < 40; ++value) {
+            tree.add_sub_node(Node<int>(value - 1), Node<int>(value));
+        }
+        CHECK(tree.lca(n4, n6) == root.get());
+        CHECK(copy.lca(n4, n6) == root.get());
+        CHECK(copy.lca(n4, n5) == n2.get());
+    }
+}
+
+TEST_CASE("Incrementally maintained subtree aggregates") {
+    Tree<int, 2, SubtreeStats<int>> tree;
+    Node<int> root_node(1);
+    tree.add_root(root_node);
+    tree.add_sub_node(root_node, Node<int>(2));
+    tree.add_sub_node(root_node, Node<int>(3));
+    tree.add_sub_node(Node<int>(2), Node<int>(4));
+    tree.add_sub_node(Node<int>(2), Node<int>(5));
+    tree.add_sub_node(Node<int>(3), Node<int>(6));
+
+    auto root = tree.getRoot();
+    auto n2 = root->children[0];
+
+    SUBCASE("Summaries after inserts") {
+        CHECK(tree.aggregate(root).size == 6);
+        CHECK(tree.aggregate(root).height == 3);
+        CHECK(tree.aggregate(root).sum == 21);
+        CHECK(tree.aggregate(n2).size == 3);
+        CHECK(tree.aggregate(n2).sum == 11);
+        CHECK(tree.aggregate(n2->children[0]).height == 1);
+    }
+
+    SUBCASE("Insert updates the root path only") {
+        tree.add_sub_node(Node<int>(6), Node<int>(7));
+        CHECK(tree.aggregate(root).size == 7);
+        CHECK(tree.aggregate(root).height == 4);
+        CHECK(tree.aggregate(root).sum == 28);
+        CHECK(tree.aggregate(n2).sum == 11);
+        CHECK(tree.aggregate(root->children[1]).height == 3);
+    }
+
+    SUBCASE("Heap rebuild recomputes summaries") {
+        tree.myHeap();
+        auto heap_root = tree.getRoot();
+        CHECK(heap_root->get_value() == 1);
+        CHECK(tree.aggregate(heap_root).size == 6);
+        CHECK(tree.aggregate(heap_root).sum == 21);
+        for (const auto& child : heap_root->children) {
+            CHECK(child->parent == heap_root.get());
+        }
+    }
+
+    SUBCASE("set_value keeps summaries, indexes and heap order in sync") {
+        tree.enable_value_filter(16);
+        CHECK(tree.find(5) != nullptr);
+        tree.set_value(n2->children[1], 50);
+        CHECK(tree.aggregate(root).sum == 66);
+        CHECK(tree.aggregate(n2).sum == 56);
+        CHECK(tree.find(5) == nullptr);
+        CHECK(tree.find(50) == n2->children[1]);
+        CHECK(tree.may_contain(50));
+
+        tree.myHeap();
+        auto top = tree.getRoot();
+        tree.set_value(top, 40);
+        CHECK(tree.peek() == 2);
+        tree.set_value(tree.find(50), 0);
+        CHECK(tree.peek() == 0);
+        CHECK(tree.aggregate(tree.getRoot()).sum == 55);
+
+        Tree<int> bst;
+        bst.bst_insert(2);
+        CHECK_THROWS_AS(bst.set_value(bst.getRoot(), 3), std::logic_error);
+        CHECK_THROWS_AS(tree.set_value(bst.getRoot(), 3), std::invalid_argument);
+    }
+
+    SUBCASE("Nodes added with children of their own are linked in") {
+        Node<int> branch(7);
+        branch.children.push_back(std::make_shared<Node<int>>(8));
+        branch.children[0]->children.push_back(std::make_shared<Node<int>>(9));
+        tree.add_sub_node(Node<int>(6), branch);
+        auto n9 = root->children[1]->children[0]->children[0]->children[0]->children[0];
+        CHECK(n9->parent->parent->value == 7);
+        CHECK(tree.aggregate(root).size == 9);
+        CHECK(tree.aggregate(root).sum == 45);
+        CHECK(tree.aggregate(root).height == 6);
+
+        Tree<int, 2, SubtreeStats<int>> copied;
+        copied.add_root(*root);
+        CHECK(copied.aggregate(copied.getRoot()).size == 9);
+        auto part = copied.detach(copied.getRoot()->children[1]);
+        CHECK(part.aggregate(part.getRoot()).sum == 33);
+        CHECK(copied.aggregate(copied.getRoot()).size == 4);
+    }
+}
+
+TEST_CASE("Heap mode push and pop") {
+    Tree<int, 2, SubtreeStats<int>> tree;
+    Node<int> root_node(5);
+    tree.add_root(root_node);
+    tree.add_sub_node(root_node, Node<int>(3));
+    tree.add_sub_node(root_node, Node<int>(8));
+    tree.add_sub_node(Node<int>(3), Node<int>(1));
+
+    SUBCASE("Push keeps the tree heap-shaped") {
+        tree.push(0);
+        tree.push(9);
+        tree.push(2);
+        CHECK(tree.peek() == 0);
+        CHECK(tree.heap_size() == 7);
+        std::vector<int> bfs;
+        for (auto node = tree.begin_bfs_scan(); node != tree.end_bfs_scan(); ++node) {
+            bfs.push_back((*node).get_value());
+        }
+        CHECK(bfs.size() == 7);
+        CHECK(std::is_heap(bfs.begin(), bfs.end(), std::greater<int>()));
+        CHECK(tree.aggregate(tree.getRoot()).size == 7);
+        CHECK(tree.aggregate(tree.getRoot()).sum == 28);
+    }
+
+    SUBCASE("Pop returns values in ascending order") {
+        tree.push(7);
+        tree.push(4);
+        std::vector<int> popped;
+        while (tree.heap_size() > 0) {
+            popped.push_back(tree.pop_min());
+            std::vector<int> bfs;
+            for (auto node = tree.begin_bfs_scan(); node != tree.end_bfs_scan(); ++node) {
+                bfs.push_back((*node).get_value());
+                if (node != tree.begin_bfs_scan()) {
+                    CHECK((*node).parent != nullptr);
+                }
+            }
+            CHECK(bfs.size() == tree.heap_size());
+            CHECK(std::is_heap(bfs.begin(), bfs.end(), std::greater<int>()));
+            if (tree.getRoot()) {
+                CHECK(tree.aggregate(tree.getRoot()).size == tree.heap_size());
+            }
+        }
+        CHECK(popped == std::vector<int>({1, 3, 4, 5, 7, 8}));
+        CHECK(tree.getRoot() == nullptr);
+        CHECK_THROWS_AS(tree.pop_min(), std::out_of_range);
+    }
+
+    SUBCASE("Replace top") {
+        CHECK_THROWS_AS(tree.peek(), std::out_of_range);
+        CHECK(tree.replace_top(6) == 1);
+        CHECK(tree.peek() == 3);
+        CHECK(tree.aggregate(tree.getRoot()).sum == 22);
+    }
+
+    SUBCASE("Push on an empty tree") {
+        Tree<int> empty;
+        empty.push(4);
+        empty.push(2);
+        CHECK(empty.peek() == 2);
+        CHECK(empty.getRoot()->children.size() == 1);
+    }
+}
+
+// Checks the K-ary heap property on values in heap array order
+template <int K>
+bool isKaryMinHeap(const std::vector<int>& values) {
+    for (size_t i = 1; i < values.size(); ++i) {
+        if (values[i] < values[(i - 1) / K]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+TEST_CASE("K-ary heap layout") {
+    Tree<int, 3> tree;
+    Node<int> root_node(9);
+    tree.add_root(root_node);
+    tree.add_sub_node(root_node, Node<int>(8));
+    tree.add_sub_node(root_node, Node<int>(7));
+    tree.add_sub_node(root_node, Node<int>(6));
+    tree.add_sub_node(Node<int>(8), Node<int>(5));
+    tree.add_sub_node(Node<int>(8), Node<int>(4));
+    tree.add_sub_node(Node<int>(8), Node<int>(3));
+    tree.add_sub_node(Node<int>(7), Node<int>(2));
+    tree.add_sub_node(Node<int>(7), Node<int>(1));
+
+    SUBCASE("myHeap uses K children per node") {
+        tree.myHeap();
+        CHECK(tree.getRoot()->get_value() == 1);
+        CHECK(tree.getRoot()->children.size() == 3);
+        std::vector<int> bfs, heap;
+        for (auto node = tree.begin_bfs_scan(); node != tree.end_bfs_scan(); ++node) {
+            bfs.push_back((*node).get_value());
+        }
+        for (auto node = tree.begin_heap(); node != tree.end_heap(); ++node) {
+            heap.push_back((*node).get_value());
+        }
+        CHECK(isKaryMinHeap<3>(bfs));
+        CHECK(heap == bfs);
+    }
+
+    SUBCASE("Push and pop on a 3-ary heap") {
+        tree.push(0);
+        tree.push(5);
+        std::vector<int> bfs;
+        for (auto node = tree.begin_bfs_scan(); node != tree.end_bfs_scan(); ++node) {
+            bfs.push_back((*node).get_value());
+        }
+        CHECK(isKaryMinHeap<3>(bfs));
+        std::vector<int> popped;
+        while (tree.heap_size() > 0) {
+            popped.push_back(tree.pop_min());
+        }
+        CHECK(std::is_sorted(popped.begin(), popped.end()));
+        CHECK(popped.size() == bfs.size());
+    }
+
+    SUBCASE("Heap visit order is 3-ary") {
+        std::vector<int> heap;
+        tree.visit<HeapOrder>([&heap](Node<int>& node) { heap.push_back(node.get_value()); });
+        CHECK(isKaryMinHeap<3>(heap));
+    }
+}
+
+TEST_CASE("Indexed heap operations") {
+    Tree<int> tree;
+    tree.myHeap();
+    std::vector<std::shared_ptr<Node<int>>> handles;
+    for (int value : {50, 40, 30, 20, 10, 60, 70}) {
+        handles.push_back(tree.push(value));
+    }
+
+    SUBCASE("Decrease key moves a node to the top") {
+        tree.decrease_key(handles[6], 5);
+        CHECK(tree.peek() == 5);
+        CHECK(tree.getRoot() == handles[6]);
+        CHECK_THROWS_AS(tree.decrease_key(handles[0], 99), std::invalid_argument);
+    }
+
+    SUBCASE("Increase key sinks the minimum") {
+        tree.increase_key(handles[4], 45);
+        CHECK(tree.pop_min() == 20);
+        CHECK(tree.pop_min() == 30);
+        CHECK(tree.pop_min() == 40);
+        CHECK(tree.pop_min() == 45);
+    }
+
+    SUBCASE("Erase by handle") {
+        tree.erase(handles[3]);
+        tree.erase(handles[0]);
+        CHECK(tree.heap_size() == 5);
+        std::vector<int> popped;
+        while (tree.heap_size() > 0) {
+            popped.push_back(tree.pop_min());
+        }
+        CHECK(popped == std::vector<int>({10, 30, 40, 60, 70}));
+        CHECK_THROWS_AS(tree.erase(handles[1]), std::out_of_range);
+    }
+}
+
+TEST_CASE("Pairing heap meld and pop") {
+    Tree<int> tree = createBasicIntTree();
+    PairingHeap<int> a(tree);
+    PairingHeap<int> b;
+    for (int value : {9, 0, 7, 3}) {
+        b.push(value);
+    }
+
+    SUBCASE("Pop returns values in ascending order") {
+        CHECK(a.size() == 6);
+        CHECK(a.top() == 1);
+        std::vector<int> popped;
+        while (!a.empty()) {
+            popped.push_back(a.pop());
+        }
+        CHECK(popped == std::vector<int>({1, 2, 3, 4, 5, 6}));
+        CHECK_THROWS_AS(a.pop(), std::out_of_range);
+    }
+
+    SUBCASE("Meld takes every node of the other heap") {
+        a.meld(b);
+        CHECK(b.empty());
+        CHECK(a.size() == 10);
+        CHECK(a.top() == 0);
+        std::vector<int> popped;
+        while (!a.empty()) {
+            popped.push_back(a.pop());
+        }
+        CHECK(popped == std::vector<int>({0, 1, 2, 3, 3, 4, 5, 6, 7, 9}));
+    }
+
+    SUBCASE("Heap shape is walkable with tree iterators") {
+        size_t count = 0;
+        for (Tree<int>::PreOrderIterator it(b.getRoot()), end(nullptr); it != end; ++it) {
+            ++count;
+            for (const auto& child : (*it).children) {
+                CHECK((*it).get_value() <= child->get_value());
+            }
+        }
+        CHECK(count == 4);
+    }
+}
+
+TEST_CASE("Parallel heap construction on a large tree") {
+    // Large enough that gather, heapify and rewiring all take their parallel paths
+    const int count = 200000;
+    Tree<int, 3> tree;
+    tree.add_root(Node<int>(count));
+    std::vector<std::shared_ptr<Node<int>>> nodes(1, tree.getRoot());
+    for (int i = 1; i < count; ++i) {
+        auto node = std::make_shared<Node<int>>((i * 7919) % count);
+        nodes[(i - 1) / 3]->children.push_back(node);
+        nodes.push_back(node);
+    }
+
+    tree.myHeap();
+    std::vector<int> values;
+    std::vector<Node<int>*> order;
+    for (auto node = tree.begin_bfs_scan(); node != tree.end_bfs_scan(); ++node) {
+        values.push_back((*node).get_value());
+        order.push_back(&*node);
+    }
+    REQUIRE(values.size() == static_cast<size_t>(count));
+    CHECK(isKaryMinHeap<3>(values));
+    CHECK(tree.peek() == 1);
+    bool parents_linked = true;
+    for (size_t i = 1; i < order.size(); ++i) {
+        parents_linked = parents_linked && order[i]->parent == order[(i - 1) / 3];
+    }
+    CHECK(parents_linked);
+
+    Tree<int> binary;
+    binary.add_root(Node<int>(count));
+    std::vector<std::shared_ptr<Node<int>>> binary_nodes(1, binary.getRoot());
+    for (int i = 1; i < count; ++i) {
+        auto node = std::make_shared<Node<int>>((i * 7919) % count);
+        binary_nodes[(i - 1) / 2]->children.push_back(node);
+        binary_nodes.push_back(node);
+    }
+    binary.myHeap();
+    std::vector<int> result;
+    for (auto node = binary.begin_heap(); node != binary.end_heap(); ++node) {
+        result.push_back((*node).get_value());
+    }
+    CHECK(result.size() == static_cast<size_t>(count));
+    CHECK(std::is_heap(result.begin(), result.end(), std::greater<int>()));
+}
+
+TEST_CASE("Top-k selection") {
+    Tree<int> tree = createBasicIntTree();
+
+    SUBCASE("Smallest and largest values") {
+        CHECK(tree.top_k(3) == std::vector<int>({1, 2, 3}));
+        CHECK(tree.top_k(2, std::greater<int>()) == std::vector<int>({6, 5}));
+        CHECK(tree.top_k(10).size() == 6);
+        CHECK(tree.top_k(0).empty());
+    }
+
+    SUBCASE("Parallel variant agrees") {
+        CHECK(tree.top_k_parallel(4) == tree.top_k(4));
+        CHECK(tree.top_k_parallel(3, std::greater<int>()) == std::vector<int>({6, 5, 4}));
+    }
+
+    SUBCASE("Large k takes the selection path") {
+        Tree<int> heap;
+        for (int i = 0; i < 5000; ++i) {
+            heap.push((i * 37) % 5000);
+        }
+        std::vector<int> expected(2000);
+        for (int i = 0; i < 2000; ++i) {
+            expected[i] = 4999 - i;
+        }
+        CHECK(heap.top_k(2000, std::greater<int>()) == expected);
+        CHECK(heap.top_k_parallel(2000, std::greater<int>()) == expected);
+    }
+
+    SUBCASE("Strings") {
+        Tree<std::string> strings = createBasicStringTree();
+        CHECK(strings.top_k(2) == std::vector<std::string>({"child1", "child2"}));
+    }
+}
+
+TEST_CASE("Heap comparator policy") {
+    SUBCASE("Max-heap with std::greater") {
+        Tree<int, 2, NoAggregate<int>, std::greater<int>> tree;
+        Node<int> root_node(3);
+        tree.add_root(root_node);
+        tree.add_sub_node(root_node, Node<int>(8));
+        tree.add_sub_node(root_node, Node<int>(1));
+        tree.add_sub_node(Node<int>(8), Node<int>(5));
+        tree.myHeap();
+        std::vector<int> result;
+        for (auto node = tree.begin_heap(); node != tree.end_heap(); ++node) {
+            result.push_back((*node).get_value());
+        }
+        CHECK(std::is_heap(result.begin(), result.end()));
+        CHECK(tree.peek() == 8);
+        tree.push(10);
+        CHECK(tree.pop_min() == 10);
+        CHECK(tree.pop_min() == 8);
+        CHECK(tree.pop_min() == 5);
+    }
+
+    SUBCASE("Complex numbers ordered by magnitude") {
+        Tree<Complex, 2, NoAggregate<Complex>, MagnitudeLess> tree;
+        for (const Complex& c : {Complex(3, 4), Complex(-1, 0), Complex(0, 2), Complex(-6, 0)}) {
+            tree.push(c);
+        }
+        CHECK(tree.pop_min() == Complex(-1, 0));
+        CHECK(tree.pop_min() == Complex(0, 2));
+        CHECK(tree.pop_min() == Complex(3, 4));
+        CHECK(tree.pop_min() == Complex(-6, 0));
+    }
+
+    SUBCASE("Pairing heap with its own comparator") {
+        Tree<Complex, 2, NoAggregate<Complex>, MagnitudeLess> tree;
+        for (const Complex& c : {Complex(3, 4), Complex(-1, 0), Complex(0, 2), Complex(-6, 0)}) {
+            tree.push(c);
+        }
+        PairingHeap<Complex, MagnitudeLess> by_magnitude(tree);
+        PairingHeap<Complex> by_value(tree);
+        CHECK(by_magnitude.pop() == Complex(-1, 0));
+        CHECK(by_magnitude.pop() == Complex(0, 2));
+        CHECK(by_value.pop() == Complex(-6, 0));
+        CHECK(by_value.pop() == Complex(-1, 0));
+
+        PairingHeap<int, std::greater<int>> max_heap;
+        for (int value : {4, 9, 1}) {
+            max_heap.push(value);
+        }
+        CHECK(max_heap.pop() == 9);
+        CHECK(max_heap.top() == 4);
+    }
+}
+
+TEST_CASE("Sorted-order iteration") {
+    SUBCASE("Doubles including negatives") {
+        Tree<double> tree;
+        Node<double> root_node(0.5);
+        tree.add_root(root_node);
+        tree.add_sub_node(root_node, Node<double>(-2.25));
+        tree.add_sub_node(root_node, Node<double>(3.0));
+        tree.add_sub_node(Node<double>(-2.25), Node<double>(-0.0));
+        tree.add_sub_node(Node<double>(-2.25), Node<double>(-7.5));
+        tree.add_sub_node(Node<double>(3.0), Node<double>(1e10));
+        std::vector<double> result;
+        for (auto node = tree.begin_sorted(); node != tree.end_sorted(); ++node) {
+            result.push_back((*node).get_value());
+        }
+        CHECK(result == std::vector<double>({-7.5, -2.25, -0.0, 0.5, 3.0, 1e10}));
+    }
+
+    SUBCASE("Index is cached until the next mutation") {
+        Tree<int> tree = createBasicIntTree();
+        const std::vector<Node<int>*>* first = &tree.sorted_index();
+        Node<int>* smallest = tree.sorted_index().front();
+        CHECK(&tree.sorted_index() == first);
+        CHECK(tree.sorted_index().front() == smallest);
+        tree.add_sub_node(Node<int>(6), Node<int>(-3));
+        CHECK(tree.sorted_index().front()->get_value() == -3);
+        CHECK(tree.sorted_index().size() == 7);
+    }
+
+    SUBCASE("Large integer tree matches std::sort") {
+        Tree<int> tree;
+        for (int i = 0; i < 100000; ++i) {
+            tree.push((i * 7919) % 100003 - 50000);
+        }
+        std::vector<int> expected, result;
+        for (auto node = tree.begin_bfs_scan(); node != tree.end_bfs_scan(); ++node) {
+            expected.push_back((*node).get_value());
+        }
+        std::sort(expected.begin(), expected.end());
+        for (auto node = tree.begin_sorted(); node != tree.end_sorted(); ++node) {
+            result.push_back((*node).get_value());
+        }
+        CHECK(result == expected);
+    }
+
+    SUBCASE("Strings fall back to comparison sort") {
+        Tree<std::string> tree = createBasicStringTree();
+        std::vector<std::string> result;
+        for (auto node = tree.begin_sorted(); node != tree.end_sorted(); ++node) {
+            result.push_back((*node).get_value());
+        }
+        CHECK(result == std::vector<std::string>({"child1", "child2", "child3", "child4", "child5", "root"}));
+    }
+}
+
+TEST_CASE("Binary search tree mode") {
+    Tree<int> tree;
+    for (int value : {50, 30, 70, 20, 40, 60, 80, 10, 35, 65}) {
+        tree.bst_insert(value);
+    }
+
+    SUBCASE("In-order traversal is sorted") {
+        std::vector<int> result;
+        for (auto node = tree.begin_in_order(); node != tree.end_in_order(); ++node) {
+            result.push_back((*node).get_value());
+        }
+        CHECK(result == std::vector<int>({10, 20, 30, 35, 40, 50, 60, 65, 70, 80}));
+        CHECK(tree.bst_size() == 10);
+    }
+
+    SUBCASE("Find, duplicates and lower_bound") {
+        CHECK(tree.bst_find(35)->get_value() == 35);
+        CHECK(tree.bst_find(36) == nullptr);
+        CHECK(tree.bst_insert(40) == tree.bst_find(40));
+        CHECK(tree.bst_size() == 10);
+        CHECK(tree.bst_lower_bound(36)->get_value() == 40);
+        CHECK(tree.bst_lower_bound(65)->get_value() == 65);
+        CHECK(tree.bst_lower_bound(81) == nullptr);
+    }
+
+    SUBCASE("Erase keeps handles and iterators working") {
+        auto handle60 = tree.bst_find(60);
+        CHECK(tree.bst_erase(50));
+        CHECK(tree.bst_erase(10));
+        CHECK(!tree.bst_erase(10));
+        CHECK(tree.bst_find(60) == handle60);
+        std::vector<int> in, pre, post;
+        for (auto node = tree.begin_in_order(); node != tree.end_in_order(); ++node) {
+            in.push_back((*node).get_value());
+        }
+        for (auto node = tree.begin_pre_order(); node != tree.end_pre_order(); ++node) {
+            pre.push_back((*node).get_value());
+        }
+        for (auto node = tree.begin_post_order(); node != tree.end_post_order(); ++node) {
+            post.push_back((*node).get_value());
+        }
+        CHECK(in == std::vector<int>({20, 30, 35, 40, 60, 65, 70, 80}));
+        CHECK(pre.size() == 8);
+        CHECK(post.size() == 8);
+        CHECK(pre.front() == post.back());
+    }
+
+    SUBCASE("Sorted inserts stay logarithmic") {
+        Tree<int, 2, SubtreeStats<int>> sorted;
+        for (int i = 0; i < 4096; ++i) {
+            sorted.bst_insert(i);
+        }
+        // Scapegoat bound with alpha = 2/3: height <= log_{3/2}(n) + 1 levels
+        CHECK(sorted.aggregate(sorted.getRoot()).height <= 22);
+        CHECK(sorted.aggregate(sorted.getRoot()).size == 4096);
+        CHECK(sorted.bst_lower_bound(1000)->get_value() == 1000);
+    }
+}
+
+TEST_CASE("B-tree") {
+    SUBCASE("Insert, find and ordered iteration") {
+        BTree<int, 4> tree;
+        for (int i = 0; i < 200; ++i) {
+            CHECK(tree.insert((i * 37) % 200));
+        }
+        CHECK(!tree.insert(42));
+        CHECK(tree.size() == 200);
+        CHECK(tree.height() > 1);
+        CHECK(tree.contains(199));
+        CHECK(!tree.contains(200));
+        CHECK(*tree.find(73) == 73);
+        CHECK(tree.find(-1) == tree.end());
+        int expected = 0;
+        for (auto it = tree.begin(); it != tree.end(); ++it) {
+            CHECK(*it == expected++);
+        }
+        CHECK(expected == 200);
+
+        std::vector<int> copied(tree.begin(), tree.end());
+        CHECK(copied.size() == 200);
+        CHECK(std::is_sorted(copied.begin(), copied.end()));
+        CHECK(std::distance(tree.lower_bound(190), tree.end()) == 10);
+        // Keys open their node, which starts on a cache line
+        CHECK(reinterpret_cast<uintptr_t>(&*tree.begin()) % 64 == 0);
+    }
+
+    SUBCASE("Lower bound and range scans") {
+        BTree<double> tree;
+        for (int i = 0; i < 1000; ++i) {
+            tree.insert(i * 0.5);
+        }
+        CHECK(*tree.lower_bound(10.2) == 10.5);
+        CHECK(*tree.lower_bound(-3.0) == 0.0);
+        CHECK(tree.lower_bound(500.0) == tree.end());
+        std::vector<double> seen;
+        CHECK(tree.visit_range(10.0, 12.0, [&](double value) { seen.push_back(value); }) == 4);
+        CHECK(seen == std::vector<double>({10.0, 10.5, 11.0, 11.5}));
+    }
+
+    SUBCASE("Non-SIMD keys and construction from a tree") {
+        Tree<std::string> source = createBasicStringTree();
+        BTree<std::string> tree(source);
+        CHECK(tree.size() == source.getNodesBFS().size());
+        for (const auto& node : source.getNodesBFS()) {
+            CHECK(tree.contains(node->value));
+        }
+    }
+}
+
+TEST_CASE("Radix trie") {
+    RadixTrie trie;
+    for (const char* key : {"/usr", "/usr/lib", "/usr/local/bin", "/usr/local/lib", "/var/log", "/vault"}) {
+        CHECK(trie.insert(key));
+    }
+
+    SUBCASE("Lookup and duplicates") {
+        CHECK(trie.size() == 6);
+        CHECK(!trie.insert("/usr/lib"));
+        CHECK(trie.contains("/usr/local/bin"));
+        CHECK(!trie.contains("/usr/local"));
+        CHECK(!trie.contains("/va"));
+        CHECK(trie.insert("/usr/local"));
+        CHECK(trie.contains("/usr/local"));
+    }
+
+    SUBCASE("Prefix enumeration is sorted") {
+        CHECK(trie.keys_with_prefix("/usr/lo") == std::vector<std::string>({"/usr/local/bin", "/usr/local/lib"}));
+        CHECK(trie.keys_with_prefix("/va") == std::vector<std::string>({"/var/log", "/vault"}));
+        CHECK(trie.keys_with_prefix("/usr").size() == 4);
+        CHECK(trie.keys_with_prefix("/opt").empty());
+        CHECK(trie.visit_prefix("", [](const std::string&) {}) == 6);
+    }
+
+    SUBCASE("Longest prefix match") {
+        CHECK(trie.longest_prefix("/usr/lib/x86_64") == 8);
+        CHECK(trie.longest_prefix("/usr/share") == 4);
+        CHECK(trie.longest_prefix("/etc") == std::string::npos);
+    }
+
+    SUBCASE("Shared prefixes use fewer nodes and bytes") {
+        RadixTrie paths;
+        for (int i = 0; i < 100; ++i) {
+            paths.insert("/home/user/projects/repository/src/file" + std::to_string(i));
+        }
+        CHECK(paths.size() == 100);
+        CHECK(paths.node_count() < 2 * paths.size());
+        CHECK(paths.memory_bytes() < paths.node_memory_bytes());
+    }
+
+    SUBCASE("Construction from a string tree") {
+        RadixTrie labels(createBasicStringTree());
+        for (const auto& node : createBasicStringTree().getNodesBFS()) {
+            CHECK(labels.contains(node->value));
+        }
+    }
+}
+
+TEST_CASE("Range queries over traversal order") {
+    SUBCASE("Segment tree and Fenwick tree") {
+        std::vector<int> values = {5, 3, 8, 1, 9, 2};
+        SegmentTree<MinMonoid<int>> minimum(values);
+        SegmentTree<MaxMonoid<int>> maximum(values);
+        FenwickTree<int> sums(values);
+        CHECK(minimum.query(0, 6) == 1);
+        CHECK(minimum.query(4, 6) == 2);
+        CHECK(maximum.query(1, 4) == 8);
+        CHECK(sums.query(1, 4) == 12);
+        CHECK(minimum.query(3, 3) == MinMonoid<int>::identity());
+        minimum.set(3, 7);
+        sums.add(3, 6);
+        CHECK(minimum.query(0, 6) == 2);
+        CHECK(sums.prefix(6) == 34);
+    }
+
+    SUBCASE("Pre-order ranges and subtree queries") {
+        Tree<int> tree = createBasicIntTree();
+        TraversalIndex<int> index(tree, PreOrder());
+        // Pre-order: 1 2 4 5 3 6
+        CHECK(index.query(0, 6) == 21);
+        CHECK(index.query(1, 4) == 11);
+        auto node2 = tree.getRoot()->children[0];
+        CHECK(index.subtree(node2) == 11);
+        index.update(node2->children[1], 50);
+        CHECK(index.subtree(node2) == 56);
+        CHECK(index.subtree(tree.getRoot()) == 66);
+        CHECK(index.value(node2->children[1]) == 50);
+        CHECK(node2->children[1]->value == 5);
+    }
+
+    SUBCASE("BFS ranges") {
+        Tree<int> tree = createBasicIntTree();
+        TraversalIndex<int, MaxMonoid<int>> index(tree, BFSOrder());
+        // BFS: 1 2 3 4 5 6
+        CHECK(index.query(0, 3) == 3);
+        CHECK(index.query(3, 6) == 6);
+        CHECK(index.node_at(index.position(tree.getRoot().get())) == tree.getRoot().get());
+        CHECK_THROWS_AS(index.subtree(tree.getRoot()), std::logic_error);
+    }
+
+    SUBCASE("Complex sums") {
+        Tree<Complex> tree;
+        tree.add_root(Node<Complex>(Complex(1, 1)));
+        tree.add_sub_node(*tree.getRoot(), Node<Complex>(Complex(2, -3)));
+        tree.add_sub_node(*tree.getRoot(), Node<Complex>(Complex(0.5, 4)));
+        TraversalIndex<Complex> index(tree, PreOrder());
+        CHECK(index.subtree(tree.getRoot()) == Complex(3.5, 2));
+        index.update(tree.getRoot()->children[1], Complex(-1, 0));
+        CHECK(index.query(1, 3) == Complex(1, -3));
+    }
+}
+
+TEST_CASE("Heavy-light path queries") {
+    // 1 -> 2, 3; 2 -> 4, 5; 3 -> 6
+    Tree<int> tree = createBasicIntTree();
+    auto root = tree.getRoot();
+    auto node2 = root->children[0];
+    auto node3 = root->children[1];
+    auto node4 = node2->children[0];
+    auto node5 = node2->children[1];
+    auto node6 = node3->children[0];
+
+    SUBCASE("Path and root-path sums") {
+        HeavyLightIndex<int> index(tree);
+        CHECK(index.size() == 6);
+        CHECK(index.path(node4, node6) == 4 + 2 + 1 + 3 + 6);
+        CHECK(index.path(node4, node5) == 4 + 2 + 5);
+        CHECK(index.path(node5, node5) == 5);
+        CHECK(index.root_path(node6) == 1 + 3 + 6);
+        CHECK(index.subtree(node2) == 11);
+    }
+
+    SUBCASE("Path updates and maxima") {
+        HeavyLightIndex<int, AddMax<int>> index(tree);
+        CHECK(index.path(node4, node3) == 4);
+        index.update_path(node5, node3, 10);
+        CHECK(index.value(node5) == 15);
+        CHECK(index.value(root) == 11);
+        CHECK(index.value(node4) == 4);
+        CHECK(index.path(node4, node2) == 12);
+        index.update_subtree(node3, -20);
+        CHECK(index.path(node6, node3) == -7);
+        CHECK(index.root_path(node6) == 11);
+    }
+
+    SUBCASE("Batch queries") {
+        HeavyLightIndex<int> index(tree);
+        index.update_path(node4, node6, 1);
+        std::vector<HeavyLightIndex<int>::path_type> queries = {{node4, node6}, {node5, root}, {node6, node6}};
+        CHECK(index.path(queries) == std::vector<int>({21, 10, 7}));
+    }
+
+    SUBCASE("Complex weights") {
+        Tree<Complex> weights;
+        weights.add_root(Node<Complex>(Complex(1, 0)));
+        weights.add_sub_node(*weights.getRoot(), Node<Complex>(Complex(0, 1)));
+        auto leaf = weights.getRoot()->children[0];
+        HeavyLightIndex<Complex> index(weights);
+        index.update_path(weights.getRoot(), leaf, Complex(1, 1));
+        CHECK(index.path(weights.getRoot(), leaf) == Complex(3, 3));
+        CHECK(index.root_path(leaf) == Complex(3, 3));
+    }
+}
+
+TEST_CASE("Value lookup") {
+    SUBCASE("find and find_all return handles") {
+        Tree<int, 3> tree;
+        tree.add_root(Node<int>(7));
+        tree.add_sub_node(Node<int>(7), Node<int>(3));
+        tree.add_sub_node(Node<int>(7), Node<int>(9));
+        tree.add_sub_node(Node<int>(3), Node<int>(9));
+        tree.add_sub_node(Node<int>(9), Node<int>(1));
+        CHECK(tree.find(7) == tree.getRoot());
+        CHECK(tree.find(4) == nullptr);
+        auto nines = tree.find_all(9);
+        REQUIRE(nines.size() == 2);
+        // Pre-order: 7 3 9 9, so the nine under 3 comes first
+        CHECK(nines[0]->parent->value == 3);
+        CHECK(nines[1]->parent == tree.getRoot().get());
+        CHECK(tree.find(9) == nines[0]);
+        CHECK(tree.find_all(5).empty());
+    }
+
+    SUBCASE("Lookups follow mutations") {
+        Tree<int> tree;
+        for (int value : {5, 2, 8}) {
+            tree.push(value);
+        }
+        CHECK(tree.find(8) != nullptr);
+        tree.pop_min();
+        CHECK(tree.find(2) == nullptr);
+        CHECK(tree.find(5)->value == 5);
+    }
+
+    SUBCASE("Heterogeneous keys") {
+        Tree<std::string> tree = createBasicStringTree();
+        std::string first = tree.getRoot()->children[0]->value;
+        CHECK(tree.find(first.c_str()) == tree.getRoot()->children[0]);
+        CHECK(tree.find("no such label") == nullptr);
+        CHECK(tree.find_all(first.c_str()).size() == 1);
+    }
+
+    SUBCASE("Nodes without a parent link have no handle") {
+        Tree<int> tree = createBasicIntTree();
+        tree.getRoot()->children[1]->children.push_back(std::make_shared<Node<int>>(7));
+        CHECK(tree.find(7) == nullptr);
+        CHECK(tree.find_all(7).empty());
+        CHECK(tree.find_range(6, 7).size() == 1);
+        CHECK(tree.find(6)->parent->value == 3);
+    }
+
+    SUBCASE("find_if scans in BFS order") {
+        Tree<int> tree = createBasicIntTree();
+        CHECK(tree.find_if([](int value) { return value > 3; })->value == 4);
+        CHECK(tree.find_if([](int value) { return value > 6; }) == nullptr);
+    }
+}
+
+// A value type with equality but no ordering and no std::hash
+struct Tag {
+    std::string name;
+    Tag(const std::string& name = "") : name(name) {}
+    bool operator==(const Tag& other) const {
+        return name == other.name;
+    }
+};
+
+TEST_CASE("Ordered value index") {
+    SUBCASE("Trees without the index or value filter need no operator< or hash") {
+        Tree<Tag> tree;
+        tree.add_root(Node<Tag>(Tag("root")));
+        tree.add_sub_node(Node<Tag>(Tag("root")), Node<Tag>(Tag("a")));
+        tree.add_sub_node(Node<Tag>(Tag("a")), Node<Tag>(Tag("b")));
+        tree.graft(tree.getRoot(), tree.detach(tree.find_if([](const Tag& tag) { return tag.name == "b"; })));
+        CHECK(tree.getRoot()->children.size() == 2);
+        CHECK(tree.getRoot()->children[1]->value == Tag("b"));
+    }
+
+    SUBCASE("Range queries over doubles stay in sync with heap operations") {
+        Tree<double> tree;
+        for (double value : {0.5, 2.5, 1.5, 3.5, 2.0}) {
+            tree.push(value);
+        }
+        auto range = tree.find_range(1.0, 2.5);
+        REQUIRE(range.size() == 3);
+        CHECK(range[0]->value == 1.5);
+        CHECK(range[2]->value == 2.5);
+
+        tree.push(1.75);
+        tree.pop_min();
+        auto handle = tree.find(3.5);
+        tree.decrease_key(handle, 1.25);
+        std::vector<double> values;
+        for (const auto& node : tree.find_range(0.0, 10.0)) {
+            values.push_back(node->value);
+        }
+        CHECK(values == std::vector<double>({1.25, 1.5, 1.75, 2.0, 2.5}));
+        CHECK(tree.find_range(2.6, 3.0).empty());
+    }
+
+    SUBCASE("Sorted enumeration survives insertion and heap rebuild") {
+        Tree<int, 3> tree;
+        tree.add_root(Node<int>(5));
+        tree.add_sub_node(Node<int>(5), Node<int>(8));
+        tree.sorted_index();
+        tree.add_sub_node(Node<int>(5), Node<int>(1));
+        tree.add_sub_node(Node<int>(8), Node<int>(6));
+        tree.myHeap();
+        std::vector<int> sorted;
+        for (auto it = tree.begin_sorted(); it != tree.end_sorted(); ++it) {
+            sorted.push_back((*it).value);
+        }
+        CHECK(sorted == std::vector<int>({1, 5, 6, 8}));
+    }
+
+    SUBCASE("Complex values use lexicographic order") {
+        Tree<Complex> tree;
+        tree.add_root(Node<Complex>(Complex(1, 5)));
+        tree.add_sub_node(Node<Complex>(Complex(1, 5)), Node<Complex>(Complex(2, -1)));
+        tree.add_sub_node(Node<Complex>(Complex(1, 5)), Node<Complex>(Complex(1, 2)));
+        tree.add_sub_node(Node<Complex>(Complex(2, -1)), Node<Complex>(Complex(3, 0)));
+        auto range = tree.find_range(Complex(1, 3), Complex(2, 0));
+        REQUIRE(range.size() == 2);
+        CHECK(range[0]->value == Complex(1, 5));
+        CHECK(range[1]->value == Complex(2, -1));
+    }
+}
+
+TEST_CASE("Value Bloom filter") {
+    SUBCASE("Standalone filter") {
+        BloomFilter<int> filter(1000, 0.01);
+        for (int i = 0; i < 1000; ++i) {
+            filter.insert(i);
+        }
+        for (int i = 0; i < 1000; ++i) {
+            CHECK(filter.possibly_contains(i));
+        }
+        int false_positives = 0;
+        for (int i = 1000; i < 11000; ++i) {
+            false_positives += filter.possibly_contains(i);
+        }
+        CHECK(false_positives < 300);
+        CHECK(filter.false_positive_rate() < 0.02);
+        CHECK(filter.memory_bytes() * 8 >= filter.bit_size());
+        CHECK(!BloomFilter<int>().enabled());
+    }
+
+    SUBCASE("Tree keeps the filter in sync") {
+        Tree<int> tree = createBasicIntTree();
+        CHECK(tree.may_contain(42));
+        tree.enable_value_filter(16, 0.01);
+        CHECK(tree.value_filter().enabled());
+        CHECK(tree.may_contain(6));
+        CHECK(tree.find(42) == nullptr);
+
+        tree.add_sub_node(Node<int>(42), Node<int>(7));
+        CHECK(tree.find(7) == nullptr);
+        tree.add_sub_node(Node<int>(6), Node<int>(7));
+        CHECK(tree.may_contain(7));
+        CHECK(tree.find(7) != nullptr);
+
+        for (int value = 100; value < 200; ++value) {
+            tree.push(value);
+        }
+        CHECK(tree.value_filter().bit_size() >= 100);
+        for (int value = 100; value < 200; ++value) {
+            CHECK(tree.may_contain(value));
+        }
+        while (tree.heap_size() > 50) {
+            tree.pop_min();
+        }
+        for (const auto& node : tree.getNodesBFS()) {
+            CHECK(tree.may_contain(node->value));
+        }
+
+        tree.disable_value_filter();
+        CHECK(tree.may_contain(-5));
+    }
+
+    SUBCASE("Complex values") {
+        Tree<Complex> tree;
+        tree.enable_value_filter(8);
+        tree.add_root(Node<Complex>(Complex(1, 2)));
+        tree.add_sub_node(Node<Complex>(Complex(1, 2)), Node<Complex>(Complex(0, 1)));
+        CHECK(tree.may_contain(Complex(0, 1)));
+        CHECK(tree.getRoot()->children.size() == 1);
+    }
+}
+
+TEST_CASE("Batched add_sub_nodes") {
+    SUBCASE("Builds several levels in one call") {
+        Tree<int, 2, SubtreeStats<int>> tree;
+        tree.add_root(Node<int>(1));
+        auto rejected = tree.add_sub_nodes({{1, 2}, {1, 3}, {2, 4}, {4, 8}, {3, 6}});
+        CHECK(rejected.empty());
+        CHECK(tree.getNodesBFS().size() == 6);
+        CHECK(tree.aggregate(tree.getRoot()).size == 6);
+        CHECK(tree.aggregate(tree.getRoot()).sum == 24);
+        CHECK(tree.find(8)->parent->value == 4);
+    }
+
+    SUBCASE("Reports missing and full parents") {
+        Tree<int> tree = createBasicIntTree();
+        auto rejected = tree.add_sub_nodes({{2, 7}, {9, 10}, {3, 11}, {3, 12}, {11, 13}});
+        REQUIRE(rejected.size() == 3);
+        CHECK(rejected[0] == std::make_pair(size_t(0), EdgeError::ParentFull));
+        CHECK(rejected[1] == std::make_pair(size_t(1), EdgeError::MissingParent));
+        CHECK(rejected[2] == std::make_pair(size_t(3), EdgeError::ParentFull));
+        CHECK(tree.getRoot()->children[1]->children.size() == 2);
+        CHECK(tree.find(13)->parent->value == 11);
+    }
+
+    SUBCASE("Empty tree rejects everything") {
+        Tree<int> tree;
+        auto rejected = tree.add_sub_nodes({{1, 2}, {2, 3}});
+        CHECK(rejected.size() == 2);
+        CHECK(rejected[1].second == EdgeError::MissingParent);
+        CHECK(tree.getRoot() == nullptr);
+    }
+}
+
+TEST_CASE("Detach, erase and graft subtrees") {
+    SUBCASE("Detach returns an independent tree") {
+        Tree<int, 2, SubtreeStats<int>> tree;
+        tree.add_root(Node<int>(1));
+        tree.add_sub_nodes({{1, 2}, {1, 3}, {2, 4}, {2, 5}, {3, 6}});
+        auto node2 = tree.find(2);
+        auto part = tree.detach(node2);
+        CHECK(part.getRoot() == node2);
+        CHECK(node2->parent == nullptr);
+        CHECK(part.aggregate(node2).sum == 11);
+        CHECK(tree.aggregate(tree.getRoot()).size == 3);
+        CHECK(tree.getRoot()->children.size() == 1);
+        CHECK(tree.find(4) == nullptr);
+        CHECK(part.find(4)->parent == node2.get());
+    }
+
+    SUBCASE("Graft moves every node and leaves the source empty") {
+        Tree<int, 2, SubtreeStats<int>> tree;
+        tree.add_root(Node<int>(1));
+        tree.add_sub_nodes({{1, 2}, {1, 3}, {3, 6}});
+        Tree<int, 2, SubtreeStats<int>> other;
+        other.add_root(Node<int>(10));
+        other.add_sub_nodes({{10, 20}, {10, 30}});
+        tree.graft(tree.find(6), std::move(other));
+        CHECK(other.getRoot() == nullptr);
+        CHECK(tree.aggregate(tree.getRoot()).size == 7);
+        CHECK(tree.aggregate(tree.getRoot()).sum == 72);
+        CHECK(tree.find(30)->parent->parent->value == 6);
+        CHECK(tree.is_ancestor(tree.find(3), tree.find(20)));
+
+        Tree<int, 2, SubtreeStats<int>> extra;
+        extra.add_root(Node<int>(99));
+        CHECK_THROWS_AS(tree.graft(tree.getRoot(), std::move(extra)), std::invalid_argument);
+    }
+
+    SUBCASE("Detaching from a BST keeps both parts BSTs") {
+        Tree<int> tree;
+        for (int value : {50, 30, 70, 20, 40, 60, 80}) {
+            tree.bst_insert(value);
+        }
+        Tree<int> right = tree.detach(tree.bst_find(80));
+        Tree<int> left = tree.detach(tree.bst_find(20));
+        CHECK(tree.bst_size() == 5);
+        CHECK(left.bst_size() == 1);
+        CHECK(tree.bst_find(40) != nullptr);
+        CHECK(tree.bst_find(20) == nullptr);
+        std::vector<int> values;
+        for (auto node = tree.begin_in_order(); node != tree.end_in_order(); ++node) {
+            values.push_back((*node).get_value());
+        }
+        CHECK(values == std::vector<int>({30, 40, 50, 60, 70}));
+
+        // Shrinking below 2/3 of the peak rebuilds the rest balanced
+        tree.erase_subtree(tree.bst_find(70));
+        CHECK(tree.bst_size() == 3);
+        CHECK(tree.getRoot()->value == 40);
+        auto handle90 = right.bst_insert(90);
+        CHECK(right.bst_find(90) == handle90);
+        CHECK(right.bst_size() == 2);
+    }
+
+    SUBCASE("Nodes of another tree are rejected") {
+        Tree<int> tree = createBasicIntTree();
+        Tree<int> other = createBasicIntTree();
+        auto other_leaf = other.getRoot()->children[1]->children[0];
+        CHECK_THROWS_AS(tree.graft(other_leaf, std::move(other)), std::invalid_argument);
+        CHECK_THROWS_AS(tree.graft(tree.getRoot(), std::move(tree)), std::invalid_argument);
+        CHECK_THROWS_AS(tree.detach(other_leaf), std::invalid_argument);
+        CHECK(other.getRoot()->children[1]->children[0] == other_leaf);
+        CHECK(tree.getNodesBFS().size() == 6);
+    }
+
+    SUBCASE("Erase and move within one tree") {
+        Tree<int> tree = createBasicIntTree();
+        tree.erase_subtree(tree.getRoot()->children[1]);
+        CHECK(tree.getNodesBFS().size() == 4);
+        auto node5 = tree.getRoot()->children[0]->children[1];
+        tree.graft(tree.getRoot(), tree.detach(node5));
+        std::vector<int> values;
+        for (auto node = tree.begin_pre_order(); node != tree.end_pre_order(); ++node) {
+            values.push_back((*node).get_value());
+        }
+        CHECK(values == std::vector<int>({1, 2, 4, 5}));
+        CHECK(tree.getRoot()->children[1] == node5);
+
+        tree.erase_subtree(tree.getRoot());
+        CHECK(tree.getRoot() == nullptr);
+    }
+}
+
+TEST_CASE("Merkle hashes") {
+    typedef Tree<int, 2, MerkleHash<int>> HashedTree;
+    auto build = [](const std::vector<std::pair<int, int>>& edges) {
+        HashedTree tree;
+        tree.add_root(Node<int>(1));
+        tree.add_sub_nodes(edges);
+        return tree;
+    };
+
+    SUBCASE("Equal shape and values give equal root hashes") {
+        HashedTree a = build({{1, 2}, {1, 3}, {2, 4}, {2, 5}, {3, 6}});
+        HashedTree b;
+        b.add_root(Node<int>(1));
+        for (const auto& edge : std::vector<std::pair<int, int>>({{1, 2}, {2, 4}, {1, 3}, {3, 6}, {2, 5}})) {
+            b.add_sub_node(Node<int>(edge.first), Node<int>(edge.second));
+        }
+        CHECK(a.aggregate(a.getRoot()) == b.aggregate(b.getRoot()));
+        CHECK(a == b);
+        CHECK(HashedTree::diff(a, b).empty());
+
+        // Same values, children swapped or moved one level down
+        CHECK(a != build({{1, 3}, {1, 2}, {2, 4}, {2, 5}, {3, 6}}));
+        CHECK(a != build({{1, 2}, {1, 3}, {2, 4}, {4, 5}, {3, 6}}));
+    }
+
+    SUBCASE("Hashes follow mutations") {
+        HashedTree a = build({{1, 2}, {1, 3}, {2, 4}});
+        HashedTree b = build({{1, 2}, {1, 3}});
+        CHECK(a != b);
+        a.erase_subtree(a.find(4));
+        CHECK(a == b);
+        b.graft(b.find(3), build({}));
+        a.add_sub_node(Node<int>(3), Node<int>(1));
+        CHECK(a == b);
+    }
+
+    SUBCASE("Diff reports changed values and unmatched subtrees") {
+        HashedTree a = build({{1, 2}, {1, 3}, {2, 4}, {2, 5}, {3, 6}});
+        HashedTree b;
+        b.add_root(Node<int>(1));
+        b.add_sub_nodes({{1, 2}, {1, 3}, {2, 4}, {2, 7}});
+        auto changes = HashedTree::diff(a, b);
+        REQUIRE(changes.size() == 2);
+        CHECK(changes[0].first->value == 5);
+        CHECK(changes[0].second->value == 7);
+        CHECK(changes[1].first->value == 6);
+        CHECK(changes[1].second == nullptr);
+    }
+
+    SUBCASE("Empty BST slots are part of the shape") {
+        // 7 as a lone left child against 7 as a lone right child
+        HashedTree c;
+        c.add_root(Node<int>(5));
+        c.add_sub_node(Node<int>(5), Node<int>(7));
+        HashedTree d;
+        d.bst_insert(5);
+        d.bst_insert(7);
+        CHECK(c != d);
+        auto changes = HashedTree::diff(c, d);
+        REQUIRE(changes.size() == 2);
+        CHECK(changes[0].first->value == 7);
+        CHECK(changes[0].second == nullptr);
+        CHECK(changes[1].first == nullptr);
+        CHECK(changes[1].second->value == 7);
+
+        HashedTree e;
+        e.bst_insert(5);
+        e.bst_insert(7);
+        CHECK(d == e);
+    }
+
+    SUBCASE("Trees without Merkle hashes compare node by node") {
+        CHECK(createBasicIntTree() == createBasicIntTree());
+        Tree<int> other = createBasicIntTree();
+        other.add_sub_node(Node<int>(6), Node<int>(7));
+        CHECK(createBasicIntTree() != other);
+        CHECK(Tree<int>() == Tree<int>());
+    }
+}
@@ -7,12 +7,811 @@
 #include <stack>
 #include <iostream>
 #include <algorithm>
+#include <stdexcept>
+#include <functional>
+#include <cmath>
+#include <unordered_map>
+#include <map>
+#include <utility>
+#include <type_traits>
 #include "node.hpp"
+#include "aggregate.hpp"
+#include "parallel.hpp"
+#include "radix_sort.hpp"
+#include "euler_tour.hpp"
+#include "lca.hpp"
+#include "bloom_filter.hpp"
 
-template <typename T, int K = 2>
+// Traversal order tags for Tree::visit
+struct PreOrder {};
+struct PostOrder {};
+struct InOrder {};
+struct BFSOrder {};
+struct DFSOrder {};
+struct HeapOrder {};
+
+// Why Tree::add_sub_nodes skipped an edge
+enum class EdgeError {
+    MissingParent,
+    ParentFull
+};
+
+// Compare orders values for the heap operations: the heap top is the value that comes first.
+// It is stored and called directly, so a stateless comparator such as std::less inlines away.
+template <typename T, int K = 2, typename Aggregator = NoAggregate<T>, typename Compare = std::less<T>>
 class Tree {
+public:
+    typedef typename Aggregator::value_type aggregate_type;
+
 private:
     std::shared_ptr<Node<T>> root;
+    Compare compare;
+
+    // Per-node subtree summaries, maintained only when Aggregator::enabled
+    std::unordered_map<const Node<T>*, aggregate_type> aggregates;
+
+    void refresh_aggregate(const Node<T>* node) {
+        aggregate_type acc = Aggregator::make(node->value);
+        for (const auto& child : node->children) {
+            if (child) {
+                Aggregator::combine(acc, aggregates[child.get()]);
+            } else {
+                Aggregator::combine_empty(acc);
+            }
+        }
+        aggregates[node] = acc;
+    }
+
+    // Recomputes the summaries of node and all its ancestors
+    void refresh_path(const Node<T>* node) {
+        if (!Aggregator::enabled) return;
+        for (; node; node = node->parent) {
+            refresh_aggregate(node);
+        }
+    }
+
+    // Summaries are computed one BFS level at a time, deepest first, into an array in BFS
+    // order where each node's children are adjacent. A node reads only its children's entries,
+    // so the nodes of a wide level are split across threads; the map is filled once at the end.
+    void rebuild_aggregates() {
+        if (!Aggregator::enabled) return;
+        aggregates.clear();
+        if (!root) return;
+        std::vector<Node<T>*> order(1, root.get());
+        std::vector<size_t> first_child;
+        std::vector<size_t> level_begin(1, 0);
+        for (size_t begin = 0; begin < order.size();) {
+            size_t end = order.size();
+            for (size_t i = begin; i < end; ++i) {
+                first_child.push_back(order.size());
+                for (const auto& child : order[i]->children) {
+                    if (child) order.push_back(child.get());
+                }
+            }
+            level_begin.push_back(end);
+            begin = end;
+        }
+
+        std::vector<aggregate_type> summaries(order.size());
+        for (size_t level = level_begin.size() - 1; level-- > 0;) {
+            size_t first = level_begin[level];
+            parallel_for(level_begin[level + 1] - first, parallel_grain, [&, first](size_t begin, size_t end) {
+                for (size_t i = first + begin; i < first + end; ++i) {
+                    summaries[i] = Aggregator::make(order[i]->value);
+                    size_t c = first_child[i];
+                    for (const auto& child : order[i]->children) {
+                        if (child) {
+                            Aggregator::combine(summaries[i], summaries[c++]);
+                        } else {
+                            Aggregator::combine_empty(summaries[i]);
+                        }
+                    }
+                }
+            });
+        }
+        aggregates.reserve(order.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            aggregates.emplace(order[i], summaries[i]);
+        }
+    }
+
+    // Lockstep walk for operator== when there is no Merkle hash to compare
+    bool equal_nodes(const Tree& other, std::false_type) const {
+        std::vector<std::pair<const Node<T>*, const Node<T>*>> stack(1, std::make_pair(root.get(), other.root.get()));
+        while (!stack.empty()) {
+            const Node<T>* a = stack.back().first;
+            const Node<T>* b = stack.back().second;
+            stack.pop_back();
+            if (!a || !b) {
+                if (a || b) return false;
+                continue;
+            }
+            if (!(a->value == b->value) || a->children.size() != b->children.size()) return false;
+            for (size_t i = 0; i < a->children.size(); ++i) {
+                stack.push_back(std::make_pair(a->children[i].get(), b->children[i].get()));
+            }
+        }
+        return true;
+    }
+
+    bool equal_nodes(const Tree& other, std::true_type) const {
+        return aggregates.find(root.get())->second == other.aggregates.find(other.root.get())->second;
+    }
+
+    // True if node hangs below this tree's root; O(depth) walk up the parent links
+    bool owns(const Node<T>* node) const {
+        while (node->parent) {
+            node = node->parent;
+        }
+        return node == root.get();
+    }
+
+    // Owning handle of a node, found in its parent's child slots; nullptr for a node that is
+    // not the root yet has no parent link, such as one pushed straight onto a child list
+    std::shared_ptr<Node<T>> handle_of(const Node<T>* node) const {
+        if (node == root.get()) return root;
+        if (!node->parent) return nullptr;
+        for (const auto& child : node->parent->children) {
+            if (child.get() == node) return child;
+        }
+        return nullptr;
+    }
+
+    // Bumped on every structural mutation; cached indexes compare against it
+    size_t version = 1;
+    mutable EulerTour<T> euler;
+    mutable size_t euler_version = 0;
+    mutable LCAIndex<T> lca_table;
+    mutable size_t lca_version = 0;
+    mutable std::vector<Node<T>*> sorted_nodes;
+    mutable size_t sorted_version = 0;
+
+    // A built sorted index survives mutations that add, remove or re-value single nodes and
+    // ones that only relink nodes: those patch it in place (binary search plus a pointer shift)
+    // and bump the version through bump_version_keep_sorted(); a plain ++version drops it.
+    // Patching compares values, so mutators reach it only through hooks that sorted_index()
+    // installs: a tree that never builds the index never needs operator< on T.
+    mutable void (*sorted_insert_hook)(const Tree&, Node<T>*) = nullptr;
+    mutable void (*sorted_erase_hook)(const Tree&, const Node<T>*) = nullptr;
+
+    void sorted_insert(Node<T>* node) {
+        if (sorted_version == version && sorted_insert_hook) sorted_insert_hook(*this, node);
+    }
+
+    // Must run while node still holds the value it was indexed under
+    void sorted_erase(const Node<T>* node) {
+        if (sorted_version == version && sorted_erase_hook) sorted_erase_hook(*this, node);
+    }
+
+    static void sorted_insert_impl(const Tree& tree, Node<T>* node) {
+        std::vector<Node<T>*>& sorted = tree.sorted_nodes;
+        sorted.insert(std::upper_bound(sorted.begin(), sorted.end(), node->value,
+                                       [](const T& value, const Node<T>* other) { return value < other->value; }),
+                      node);
+    }
+
+    static void sorted_erase_impl(const Tree& tree, const Node<T>* node) {
+        std::vector<Node<T>*>& sorted = tree.sorted_nodes;
+        auto it = std::lower_bound(sorted.begin(), sorted.end(), node->value,
+                                   [](const Node<T>* other, const T& value) { return other->value < value; });
+        while (it != sorted.end() && *it != node) ++it;
+        if (it == sorted.end()) {
+            // Values without a strict weak order (NaN) cannot be located; rebuild on next use
+            tree.sorted_version = 0;
+            return;
+        }
+        sorted.erase(it);
+    }
+
+    void bump_version_keep_sorted() {
+        bool current = sorted_version == version;
+        ++version;
+        if (current) sorted_version = version;
+    }
+
+    // Patches a current sorted index for nodes entering or leaving the tree; when they are more
+    // than a small fraction of it, dropping it for a rebuild on next use is cheaper
+    void patch_sorted_index(const std::vector<Node<T>*>& nodes, bool inserting) {
+        if (sorted_version != version) return;
+        if (nodes.size() > 16 && nodes.size() * 64 > sorted_nodes.size()) {
+            sorted_version = 0;
+            return;
+        }
+        for (Node<T>* node : nodes) {
+            if (inserting) {
+                sorted_insert(node);
+            } else {
+                sorted_erase(node);
+            }
+        }
+    }
+
+    static std::vector<Node<T>*> subtree_nodes(Node<T>* start) {
+        std::vector<Node<T>*> nodes(1, start);
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            for (const auto& child : nodes[i]->children) {
+                if (!child) continue;
+                nodes.push_back(child.get());
+            }
+        }
+        return nodes;
+    }
+
+    // add_root and add_sub_node copy the caller's Node, and with it any children already hung
+    // below it; this sets the parent links under start, which the copy does not, and returns
+    // the subtree in BFS order
+    static std::vector<Node<T>*> link_subtree(Node<T>* start) {
+        std::vector<Node<T>*> nodes(1, start);
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            for (const auto& child : nodes[i]->children) {
+                if (!child) continue;
+                child->parent = nodes[i];
+                nodes.push_back(child.get());
+            }
+        }
+        return nodes;
+    }
+
+    // Drops child from parent's slots. A BST keeps a missing left child as a null slot, so
+    // there the slot is cleared; elsewhere later siblings shift down.
+    void unlink_child(Node<T>* parent, const Node<T>* child) {
+        auto it = std::find_if(parent->children.begin(), parent->children.end(),
+                               [child](const std::shared_ptr<Node<T>>& slot) { return slot.get() == child; });
+        if (bst_count > 0) {
+            it->reset();
+            while (!parent->children.empty() && !parent->children.back()) {
+                parent->children.pop_back();
+            }
+        } else {
+            parent->children.erase(it);
+        }
+    }
+
+    // Optional Bloom filter over node values, see enable_value_filter. Inserts are added as
+    // they happen; removed or overwritten values stay in the filter as false positives until
+    // they make up a quarter of it, then the next query rebuilds it from the tree.
+    // Hashing needs std::hash<T>, so mutators reach the filter only through hooks that
+    // enable_value_filter() installs: a tree that never enables it needs no hash for T.
+    mutable BloomFilter<T> bloom;
+    double bloom_rate = 0.01;
+    mutable size_t bloom_capacity = 0;
+    mutable size_t bloom_removed = 0;
+    void (*bloom_rebuild_hook)(const Tree&) = nullptr;
+    void (*bloom_insert_hook)(const Tree&, const T&) = nullptr;
+    bool (*bloom_query_hook)(const Tree&, const T&) = nullptr;
+
+    static void bloom_rebuild_impl(const Tree& tree) {
+        std::vector<const Node<T>*> stack;
+        std::vector<const T*> values;
+        if (tree.root) stack.push_back(tree.root.get());
+        while (!stack.empty()) {
+            const Node<T>* node = stack.back();
+            stack.pop_back();
+            values.push_back(&node->value);
+            for (const auto& child : node->children) {
+                if (!child) continue;
+                stack.push_back(child.get());
+            }
+        }
+        tree.bloom_capacity = std::max(tree.bloom_capacity, values.size());
+        tree.bloom = BloomFilter<T>(tree.bloom_capacity, tree.bloom_rate);
+        for (const T* value : values) {
+            tree.bloom.insert(*value);
+        }
+        tree.bloom_removed = 0;
+    }
+
+    static void bloom_insert_impl(const Tree& tree, const T& value) {
+        tree.bloom.insert(value);
+    }
+
+    static bool bloom_query_impl(const Tree& tree, const T& value) {
+        return tree.bloom.possibly_contains(value);
+    }
+
+    // Only an enabled filter is rebuilt, and enabling installs the hooks
+    void rebuild_bloom() const {
+        if (bloom.enabled()) bloom_rebuild_hook(*this);
+    }
+
+    // Call after the node holding value is linked in; doubles the filter once it is full
+    void bloom_insert(const T& value) {
+        if (!bloom.enabled()) return;
+        if (bloom.size() < bloom_capacity) {
+            bloom_insert_hook(*this, value);
+        } else {
+            bloom_capacity *= 2;
+            rebuild_bloom();
+        }
+    }
+
+    void bloom_remove() {
+        if (bloom.enabled()) ++bloom_removed;
+    }
+
+    // True when value is definitely not in the tree
+    bool bloom_rejects(const T& value) const {
+        if (!bloom.enabled()) return false;
+        if (4 * bloom_removed > bloom.size()) rebuild_bloom();
+        return !bloom_query_hook(*this, value);
+    }
+
+    // Lookups by a key of another type cannot be hashed as T, so they skip the filter
+    template <typename Key>
+    bool bloom_rejects(const Key&) const {
+        return false;
+    }
+
+    // K-ary heap over an array of node pointers: node i has children K*i+1 ... K*i+K
+    template <typename Ptr>
+    static size_t sift_nodes_down(std::vector<Ptr>& nodes, size_t i, const Compare& cmp) {
+        for (;;) {
+            size_t smallest = i;
+            size_t first = K * i + 1;
+            size_t last = std::min(first + K, nodes.size());
+            for (size_t c = first; c < last; ++c) {
+                if (cmp(nodes[c]->value, nodes[smallest]->value)) {
+                    smallest = c;
+                }
+            }
+            if (smallest == i) return i;
+            std::swap(nodes[i], nodes[smallest]);
+            i = smallest;
+        }
+    }
+
+    // Minimum work per thread for the parallel heap build
+    static const size_t parallel_grain = 1 << 14;
+
+    // Bottom-up heapify, one array level at a time. Sift-downs started on the same level
+    // touch disjoint subtrees, so each level is split across threads when it is large.
+    template <typename Ptr>
+    static void heapify_nodes(std::vector<Ptr>& nodes, const Compare& cmp) {
+        size_t internal = (nodes.size() + K - 2) / K;
+        std::vector<size_t> level_starts(1, 0);
+        while (level_starts.back() < internal) {
+            level_starts.push_back(level_starts.back() * K + 1);
+        }
+        for (size_t level = level_starts.size() - 1; level-- > 0;) {
+            size_t first = level_starts[level];
+            size_t last = std::min(level_starts[level + 1], internal);
+            parallel_for(last - first, parallel_grain, [&nodes, &cmp, first](size_t begin, size_t end) {
+                for (size_t i = first + end; i-- > first + begin;) {
+                    sift_nodes_down(nodes, i, cmp);
+                }
+            });
+        }
+    }
+
+    // Collects every node. The top of the tree is walked breadth-first until the frontier
+    // is wide enough, then frontier slices are walked depth-first on worker threads.
+    std::vector<std::shared_ptr<Node<T>>> gather_nodes() const {
+        std::vector<std::shared_ptr<Node<T>>> result, frontier, next;
+        if (!root) return result;
+        size_t wide = 4 * parallel_chunk_count(size_t(-1), 1);
+        frontier.push_back(root);
+        while (!frontier.empty() && (result.size() < parallel_grain || frontier.size() < wide)) {
+            next.clear();
+            for (const auto& node : frontier) {
+                result.push_back(node);
+                for (const auto& child : node->children) {
+                    if (child) next.push_back(child);
+                }
+            }
+            frontier.swap(next);
+        }
+        if (frontier.empty()) return result;
+
+        size_t chunks = parallel_chunk_count(frontier.size(), 1);
+        std::vector<std::vector<std::shared_ptr<Node<T>>>> parts(chunks);
+        parallel_chunks(frontier.size(), chunks, [&frontier, &parts](size_t chunk, size_t begin, size_t end) {
+            std::vector<std::shared_ptr<Node<T>>>& part = parts[chunk];
+            std::vector<Node<T>*> stack;
+            for (size_t f = begin; f < end; ++f) {
+                part.push_back(frontier[f]);
+                stack.push_back(frontier[f].get());
+                while (!stack.empty()) {
+                    Node<T>* node = stack.back();
+                    stack.pop_back();
+                    for (const auto& child : node->children) {
+                        if (!child) continue;
+                        part.push_back(child);
+                        stack.push_back(child.get());
+                    }
+                }
+            }
+        });
+
+        std::vector<size_t> offsets(chunks + 1, result.size());
+        for (size_t c = 0; c < chunks; ++c) {
+            offsets[c + 1] = offsets[c] + parts[c].size();
+        }
+        result.resize(offsets[chunks]);
+        parallel_chunks(chunks, chunks, [&result, &parts, &offsets](size_t chunk, size_t, size_t) {
+            std::move(parts[chunk].begin(), parts[chunk].end(), result.begin() + offsets[chunk]);
+        });
+        return result;
+    }
+
+    // Heap mode: nodes in K-ary heap array order, see sift_nodes_down.
+    // Entered by myHeap() or push(); any other structural mutation leaves it.
+    std::vector<std::shared_ptr<Node<T>>> heap_nodes;
+    // Node handle -> heap position, built on the first indexed operation and kept from then on
+    std::unordered_map<const Node<T>*, size_t> heap_index;
+    bool heap_indexed = false;
+    bool heap_mode = false;
+
+    void leave_heap_mode() {
+        heap_mode = false;
+        heap_nodes.clear();
+        heap_index.clear();
+        heap_indexed = false;
+    }
+
+    size_t heap_position(const Node<T>* node) {
+        if (heap_mode && !heap_indexed) {
+            heap_index.reserve(heap_nodes.size());
+            for (size_t i = 0; i < heap_nodes.size(); ++i) {
+                heap_index[heap_nodes[i].get()] = i;
+            }
+            heap_indexed = true;
+        }
+        auto it = heap_index.find(node);
+        if (!heap_mode || it == heap_index.end()) {
+            throw std::out_of_range("Tree: node is not in the heap");
+        }
+        return it->second;
+    }
+
+    // Links heap_nodes[i] into its parent's child slot and rewires its own children
+    void heap_place(size_t i) {
+        Node<T>* node = heap_nodes[i].get();
+        if (i == 0) {
+            root = heap_nodes[0];
+            node->parent = nullptr;
+        } else {
+            Node<T>* parent = heap_nodes[(i - 1) / K].get();
+            parent->children[(i - 1) % K] = heap_nodes[i];
+            node->parent = parent;
+        }
+        node->children.clear();
+        for (size_t c = K * i + 1; c <= K * i + K && c < heap_nodes.size(); ++c) {
+            node->children.push_back(heap_nodes[c]);
+            heap_nodes[c]->parent = node;
+        }
+    }
+
+    // Swaps heap positions i and its parent by relinking nodes, so node handles stay valid.
+    // Exchanging the two child vectors leaves only one slot and the parent links to fix up.
+    void heap_swap_with_parent(size_t i) {
+        size_t p = (i - 1) / K;
+        Node<T>* upper = heap_nodes[p].get();
+        Node<T>* lower = heap_nodes[i].get();
+        std::swap(heap_nodes[i], heap_nodes[p]);
+        if (heap_indexed) {
+            heap_index[upper] = i;
+            heap_index[lower] = p;
+        }
+        std::swap(upper->children, lower->children);
+        lower->children[(i - 1) % K] = heap_nodes[i];
+        lower->parent = upper->parent;
+        if (p == 0) {
+            root = heap_nodes[0];
+        } else {
+            upper->parent->children[(p - 1) % K] = heap_nodes[p];
+        }
+        for (const auto& child : lower->children) {
+            child->parent = lower;
+        }
+        for (const auto& child : upper->children) {
+            child->parent = upper;
+        }
+    }
+
+    size_t heap_sift_up(size_t i) {
+        while (i > 0 && compare(heap_nodes[i]->value, heap_nodes[(i - 1) / K]->value)) {
+            heap_swap_with_parent(i);
+            i = (i - 1) / K;
+        }
+        return i;
+    }
+
+    size_t heap_sift_down(size_t i) {
+        for (;;) {
+            size_t smallest = i;
+            for (size_t c = K * i + 1; c <= K * i + K && c < heap_nodes.size(); ++c) {
+                if (compare(heap_nodes[c]->value, heap_nodes[smallest]->value)) {
+                    smallest = c;
+                }
+            }
+            if (smallest == i) return i;
+            heap_swap_with_parent(smallest);
+            i = smallest;
+        }
+    }
+
+    // Removes the node at heap position i, refilling the hole with the last node
+    std::shared_ptr<Node<T>> heap_erase_at(size_t i) {
+        std::shared_ptr<Node<T>> removed = heap_nodes[i];
+        std::shared_ptr<Node<T>> last = heap_nodes.back();
+        heap_nodes.pop_back();
+        if (heap_indexed) {
+            heap_index.erase(removed.get());
+        }
+        aggregates.erase(removed.get());
+        sorted_erase(removed.get());
+        bloom_remove();
+
+        if (heap_nodes.empty()) {
+            root = nullptr;
+        } else {
+            size_t last_parent = (heap_nodes.size() - 1) / K;
+            heap_nodes[last_parent]->children.pop_back();
+            if (last != removed) {
+                heap_nodes[i] = last;
+                if (heap_indexed) {
+                    heap_index[last.get()] = i;
+                }
+                heap_place(i);
+                size_t j = heap_sift_down(heap_sift_up(i));
+                // Both the path that lost a leaf and the sift path need fresh summaries;
+                // i and j share a root path and the larger index is the deeper one
+                refresh_path(heap_nodes[last_parent].get());
+                refresh_path(heap_nodes[std::max(i, j)].get());
+            } else {
+                refresh_path(heap_nodes[last_parent].get());
+            }
+        }
+        removed->children.clear();
+        removed->parent = nullptr;
+        bump_version_keep_sorted();
+        return removed;
+    }
+
+    void require_heap_top() const {
+        if (!heap_mode || heap_nodes.empty()) {
+            throw std::out_of_range("Tree: heap is empty or not built");
+        }
+    }
+
+    // Keeps the k values that come first under cmp. Small k uses a bounded heap whose front
+    // is the worst value kept; large k appends to a buffer and trims it back to k with
+    // nth_element whenever it reaches 2k, which is O(n) overall.
+    template <typename Select>
+    class TopKCollector {
+    private:
+        static const size_t heap_limit = 1024;
+        std::vector<T> kept;
+        size_t k;
+        Select cmp;
+
+        void trim() {
+            std::nth_element(kept.begin(), kept.begin() + k, kept.end(), cmp);
+            kept.erase(kept.begin() + k, kept.end());
+        }
+
+    public:
+        TopKCollector(size_t k, Select cmp) : k(k), cmp(cmp) {}
+
+        void add(const T& value) {
+            if (k == 0) return;
+            if (k <= heap_limit) {
+                if (kept.size() < k) {
+                    kept.push_back(value);
+                    std::push_heap(kept.begin(), kept.end(), cmp);
+                } else if (cmp(value, kept.front())) {
+                    std::pop_heap(kept.begin(), kept.end(), cmp);
+                    kept.back() = value;
+                    std::push_heap(kept.begin(), kept.end(), cmp);
+                }
+            } else {
+                kept.push_back(value);
+                if (kept.size() >= 2 * k) trim();
+            }
+        }
+
+        // The kept values, sorted under cmp
+        std::vector<T> finish() {
+            if (kept.size() > k) trim();
+            std::sort(kept.begin(), kept.end(), cmp);
+            return std::move(kept);
+        }
+    };
+
+    // BST mode (K == 2): children[0] is the left subtree and children[1] the right one; a
+    // missing left child is a null slot, trailing null slots are dropped. Balance is kept
+    // scapegoat-style with alpha = 2/3, which needs no per-node data: an insert that lands
+    // deeper than log_{3/2}(n) rebuilds the highest unbalanced ancestor perfectly balanced,
+    // and erase rebuilds the whole tree once it has shrunk below 2/3 of its peak size.
+    size_t bst_count = 0;
+    size_t bst_max_count = 0;
+
+    static Node<T>* bst_child(const Node<T>* node, size_t side) {
+        return side < node->children.size() ? node->children[side].get() : nullptr;
+    }
+
+    static void bst_set_child(Node<T>* node, size_t side, const std::shared_ptr<Node<T>>& child) {
+        if (node->children.size() <= side) {
+            node->children.resize(side + 1);
+        }
+        node->children[side] = child;
+        while (!node->children.empty() && !node->children.back()) {
+            node->children.pop_back();
+        }
+        if (child) child->parent = node;
+    }
+
+    static size_t bst_side(const Node<T>* parent, const Node<T>* child) {
+        return bst_child(parent, 0) == child ? 0 : 1;
+    }
+
+    // Owning handle of a node, taken from its parent's slot
+    std::shared_ptr<Node<T>> bst_handle(Node<T>* node) const {
+        if (!node->parent) return root;
+        return node->parent->children[bst_side(node->parent, node)];
+    }
+
+    // Hangs replacement where node hangs now, possibly at the root
+    void bst_replace(Node<T>* node, const std::shared_ptr<Node<T>>& replacement) {
+        Node<T>* parent = node->parent;
+        if (!parent) {
+            root = replacement;
+            if (replacement) replacement->parent = nullptr;
+        } else {
+            bst_set_child(parent, bst_side(parent, node), replacement);
+        }
+    }
+
+    static size_t bst_depth_limit(size_t count) {
+        return static_cast<size_t>(std::log(static_cast<double>(count)) / std::log(1.5));
+    }
+
+    static size_t bst_subtree_count(const Node<T>* node) {
+        size_t count = 0;
+        std::vector<const Node<T>*> stack;
+        if (node) stack.push_back(node);
+        while (!stack.empty()) {
+            const Node<T>* current = stack.back();
+            stack.pop_back();
+            ++count;
+            for (const auto& child : current->children) {
+                if (child) stack.push_back(child.get());
+            }
+        }
+        return count;
+    }
+
+    // Links in-order nodes [first, last) into a perfectly balanced subtree
+    static std::shared_ptr<Node<T>> bst_build(const std::vector<std::shared_ptr<Node<T>>>& nodes, size_t first, size_t last) {
+        if (first == last) return nullptr;
+        size_t mid = first + (last - first) / 2;
+        const std::shared_ptr<Node<T>>& node = nodes[mid];
+        node->children.clear();
+        bst_set_child(node.get(), 0, bst_build(nodes, first, mid));
+        bst_set_child(node.get(), 1, bst_build(nodes, mid + 1, last));
+        return node;
+    }
+
+    void bst_rebuild(Node<T>* node) {
+        Node<T>* parent = node->parent;
+        size_t side = parent ? bst_side(parent, node) : 0;
+        std::vector<std::shared_ptr<Node<T>>> nodes, stack;
+        std::shared_ptr<Node<T>> current = bst_handle(node);
+        while (current || !stack.empty()) {
+            while (current) {
+                stack.push_back(current);
+                current = current->children.empty() ? nullptr : current->children[0];
+            }
+            current = stack.back();
+            stack.pop_back();
+            nodes.push_back(current);
+            current = current->children.size() > 1 ? current->children[1] : nullptr;
+        }
+        std::shared_ptr<Node<T>> rebuilt = bst_build(nodes, 0, nodes.size());
+        if (parent) {
+            bst_set_child(parent, side, rebuilt);
+        } else {
+            root = rebuilt;
+            rebuilt->parent = nullptr;
+        }
+        if (Aggregator::enabled) {
+            visit<PostOrder>(rebuilt, [this](Node<T>& n) { refresh_aggregate(&n); });
+            refresh_path(parent);
+        }
+    }
+
+    // A tree entering BST mode from add_root/add_sub_node is adopted as is; its values
+    // must already be in BST order
+    void bst_adopt() {
+        if (bst_count == 0 && root) {
+            bst_count = bst_max_count = bst_subtree_count(root.get());
+        }
+    }
+
+    // Each call keeps its own stack, so a visitor may start another visit on the same tree
+    template <typename Visitor>
+    void visit_impl(Node<T>* start, Visitor& visitor, PreOrder) const {
+        std::vector<Node<T>*> stack;
+        stack.push_back(start);
+        while (!stack.empty()) {
+            Node<T>* node = stack.back();
+            stack.pop_back();
+            visitor(*node);
+            for (auto it = node->children.rbegin(); it != node->children.rend(); ++it) {
+                if (!*it) continue;
+                stack.push_back(it->get());
+            }
+        }
+    }
+
+    template <typename Visitor>
+    void visit_impl(Node<T>* start, Visitor& visitor, DFSOrder) const {
+        visit_impl(start, visitor, PreOrder());
+    }
+
+    template <typename Visitor>
+    void visit_impl(Node<T>* start, Visitor& visitor, PostOrder) const {
+        // Each frame holds a node and the index of the next child to descend into
+        std::vector<std::pair<Node<T>*, size_t>> frames;
+        frames.push_back(std::make_pair(start, size_t(0)));
+        while (!frames.empty()) {
+            auto& frame = frames.back();
+            if (frame.second < frame.first->children.size()) {
+                Node<T>* child = frame.first->children[frame.second++].get();
+                if (child) frames.push_back(std::make_pair(child, size_t(0)));
+            } else {
+                visitor(*frame.first);
+                frames.pop_back();
+            }
+        }
+    }
+
+    template <typename Visitor>
+    void visit_impl(Node<T>* start, Visitor& visitor, InOrder) const {
+        std::vector<Node<T>*> stack;
+        Node<T>* node = start;
+        while (node || !stack.empty()) {
+            while (node) {
+                stack.push_back(node);
+                node = node->children.empty() ? nullptr : node->children[0].get();
+            }
+            node = stack.back();
+            stack.pop_back();
+            visitor(*node);
+            node = node->children.size() > 1 ? node->children[1].get() : nullptr;
+        }
+    }
+
+    template <typename Visitor>
+    void visit_impl(Node<T>* start, Visitor& visitor, BFSOrder) const {
+        // The buffer doubles as the queue; head marks the front
+        std::vector<Node<T>*> nodes;
+        nodes.push_back(start);
+        for (size_t head = 0; head < nodes.size(); ++head) {
+            Node<T>* node = nodes[head];
+            visitor(*node);
+            for (const auto& child : node->children) {
+                if (!child) continue;
+                nodes.push_back(child.get());
+            }
+        }
+    }
+
+    template <typename Visitor>
+    void visit_impl(Node<T>* start, Visitor& visitor, HeapOrder) const {
+        std::vector<Node<T>*> nodes;
+        nodes.push_back(start);
+        for (size_t head = 0; head < nodes.size(); ++head) {
+            for (const auto& child : nodes[head]->children) {
+                if (!child) continue;
+                nodes.push_back(child.get());
+            }
+        }
+        heapify_nodes(nodes, compare);
+        for (Node<T>* node : nodes) {
+            visitor(*node);
+        }
+    }
 
     void print_tree(std::shared_ptr<Node<T>> node, int depth) const {
         if (!node) return;
@@ -27,17 +826,26 @@ private:
 
 public:
     Tree() : root(nullptr) {}
+
+    explicit Tree(Compare compare) : root(nullptr), compare(compare) {}
       
     std::shared_ptr<Node<T>> getRoot() const {
         return root;
     }
 
     void add_root(const Node<T>& node) {
+        leave_heap_mode();
+        bst_count = 0;
         root = std::make_shared<Node<T>>(node);
+        root->parent = nullptr;
+        link_subtree(root.get());
+        rebuild_aggregates();
+        rebuild_bloom();
+        ++version;
     }
 
     void add_sub_node(const Node<T>& parent, const Node<T>& child) {
-        if (!root) return;
+        if (!root || bloom_rejects(parent.value)) return;
         std::queue<std::shared_ptr<Node<T>>> nodes;
         nodes.push(root);
         while (!nodes.empty()) {
@@ -45,28 +853,224 @@ public:
             nodes.pop();
             if (current->value == parent.value) {
                 if (current->children.size() < K) {
+                    leave_heap_mode();
+                    bst_count = 0;
                     current->children.push_back(std::make_shared<Node<T>>(child));
+                    Node<T>* added = current->children.back().get();
+                    added->parent = current.get();
+                    std::vector<Node<T>*> linked = link_subtree(added);
+                    if (Aggregator::enabled) {
+                        // Reverse BFS order reaches every node after its children
+                        for (size_t i = linked.size(); i-- > 1;) {
+                            refresh_aggregate(linked[i]);
+                        }
+                    }
+                    refresh_path(added);
+                    patch_sorted_index(linked, true);
+                    for (Node<T>* node : linked) {
+                        bloom_insert(node->value);
+                    }
+                    bump_version_keep_sorted();
                 }
                 return;
             }
             for (const auto& child : current->children) {
+                if (!child) continue;
                 nodes.push(child);
             }
         }
     }
 
+    // Adds many (parent value, child value) edges in one pass instead of one BFS per edge.
+    // Parents resolve to the first BFS match among the nodes present before the call, or else
+    // to the first node with that value added earlier in the same batch, so a batch can grow
+    // several levels. Edges are applied in order; the ones skipped because no parent matched
+    // or the parent already has K children come back as (edge index, reason).
+    std::vector<std::pair<size_t, EdgeError>> add_sub_nodes(const std::vector<std::pair<T, T>>& edges) {
+        std::vector<std::pair<size_t, EdgeError>> rejected;
+        if (!root) {
+            for (size_t i = 0; i < edges.size(); ++i) {
+                rejected.push_back(std::make_pair(i, EdgeError::MissingParent));
+            }
+            return rejected;
+        }
+
+        // One BFS resolves every requested parent value, stopping once all are found
+        std::map<T, Node<T>*> parents;
+        for (const auto& edge : edges) {
+            parents.insert(std::make_pair(edge.first, static_cast<Node<T>*>(nullptr)));
+        }
+        size_t unresolved = parents.size();
+        std::queue<Node<T>*> nodes;
+        nodes.push(root.get());
+        while (!nodes.empty() && unresolved > 0) {
+            Node<T>* current = nodes.front();
+            nodes.pop();
+            auto it = parents.find(current->value);
+            if (it != parents.end() && !it->second) {
+                it->second = current;
+                --unresolved;
+            }
+            for (const auto& child : current->children) {
+                if (!child) continue;
+                nodes.push(child.get());
+            }
+        }
+
+        size_t added = 0;
+        for (size_t i = 0; i < edges.size(); ++i) {
+            Node<T>* parent = parents[edges[i].first];
+            if (!parent) {
+                rejected.push_back(std::make_pair(i, EdgeError::MissingParent));
+                continue;
+            }
+            if (parent->children.size() >= K) {
+                rejected.push_back(std::make_pair(i, EdgeError::ParentFull));
+                continue;
+            }
+            if (added == 0) {
+                leave_heap_mode();
+                bst_count = 0;
+            }
+            parent->children.push_back(std::make_shared<Node<T>>(edges[i].second));
+            Node<T>* child = parent->children.back().get();
+            child->parent = parent;
+            auto it = parents.find(child->value);
+            if (it != parents.end() && !it->second) {
+                it->second = child;
+            }
+            bloom_insert(child->value);
+            ++added;
+        }
+        if (added > 0) {
+            // Summaries and the sorted index are rebuilt once rather than patched per edge
+            rebuild_aggregates();
+            ++version;
+        }
+        return rejected;
+    }
+
+    // Removes the subtree rooted at node and returns it as an independent tree with the same
+    // Compare. Unlinking is O(K); summaries on the old root path are refreshed in O(K * depth),
+    // and per-node side data (summaries, a small patch of the sorted index) moves in O(size of
+    // the subtree). Euler tour and LCA are rebuilt lazily as after any mutation.
+    // In BST mode both parts stay BSTs, and the rest is rebuilt balanced like after bst_erase
+    // once it has shrunk below 2/3 of its peak size.
+    Tree detach(std::shared_ptr<Node<T>> node) {
+        Tree detached(compare);
+        if (!node) return detached;
+        if (!owns(node.get())) {
+            throw std::invalid_argument("Tree: detach needs a node of this tree");
+        }
+        Node<T>* parent = node->parent;
+        leave_heap_mode();
+
+        std::vector<Node<T>*> moved;
+        if (Aggregator::enabled || sorted_version == version || bloom.enabled()) {
+            moved = subtree_nodes(node.get());
+        }
+        patch_sorted_index(moved, false);
+        if (bloom.enabled()) bloom_removed += moved.size();
+        if (Aggregator::enabled) {
+            for (Node<T>* moved_node : moved) {
+                auto it = aggregates.find(moved_node);
+                detached.aggregates[moved_node] = it->second;
+                aggregates.erase(it);
+            }
+        }
+
+        // Both parts of a BST are BSTs again; unlink_child keeps the null slots while bst_count is set
+        size_t moved_count = 0;
+        if (bst_count > 0) {
+            moved_count = moved.empty() ? bst_subtree_count(node.get()) : moved.size();
+        }
+        if (parent) {
+            unlink_child(parent, node.get());
+            refresh_path(parent);
+        } else {
+            root = nullptr;
+        }
+        node->parent = nullptr;
+        detached.root = node;
+        if (bst_count > 0) {
+            bst_count -= moved_count;
+            detached.bst_count = detached.bst_max_count = moved_count;
+            if (root && 3 * bst_count < 2 * bst_max_count) {
+                bst_rebuild(root.get());
+                bst_max_count = bst_count;
+            }
+        }
+        bump_version_keep_sorted();
+        return detached;
+    }
+
+    // Removes and destroys the subtree rooted at node
+    void erase_subtree(std::shared_ptr<Node<T>> node) {
+        detach(node);
+    }
+
+    // Hangs the root of other below parent as its last child, leaving other empty. O(K) to link
+    // plus O(K * depth) summary refresh; other's summaries move over in O(size of other), and
+    // the sorted index and value filter are patched the same way. Throws if parent is full or
+    // is not a node of this tree, which also rules out grafting a tree into itself.
+    void graft(std::shared_ptr<Node<T>> parent, Tree&& other) {
+        if (&other == this) {
+            throw std::invalid_argument("Tree: cannot graft a tree into itself");
+        }
+        if (!other.root) return;
+        if (!parent || !owns(parent.get())) {
+            throw std::invalid_argument("Tree: graft needs a parent node of this tree");
+        }
+        if (parent->children.size() >= K) {
+            throw std::invalid_argument("Tree: graft parent already has K children");
+        }
+        leave_heap_mode();
+
+        std::vector<Node<T>*> moved;
+        if (Aggregator::enabled || sorted_version == version || bloom.enabled()) {
+            moved = subtree_nodes(other.root.get());
+        }
+        if (Aggregator::enabled) {
+            for (Node<T>* moved_node : moved) {
+                aggregates[moved_node] = other.aggregates[moved_node];
+            }
+        }
+        parent->children.push_back(other.root);
+        other.root->parent = parent.get();
+        refresh_path(parent.get());
+        patch_sorted_index(moved, true);
+        for (Node<T>* moved_node : moved) {
+            bloom_insert(moved_node->value);
+        }
+        bst_count = 0;
+        bump_version_keep_sorted();
+
+        other.root = nullptr;
+        other.leave_heap_mode();
+        other.aggregates.clear();
+        other.bst_count = 0;
+        other.rebuild_bloom();
+        ++other.version;
+    }
+
     // Method to get nodes in BFS order
     std::vector<std::shared_ptr<Node<T>>> getNodesBFS() const {
+        return getNodesBFS(root);
+    }
+
+    // Nodes of the subtree rooted at start, in BFS order
+    std::vector<std::shared_ptr<Node<T>>> getNodesBFS(std::shared_ptr<Node<T>> start) const {
         std::vector<std::shared_ptr<Node<T>>> result;
-        if (!root) return result;
+        if (!start) return result;
 
         std::queue<std::shared_ptr<Node<T>>> queue;
-        queue.push(root);
+        queue.push(start);
         while (!queue.empty()) {
             auto node = queue.front();
             queue.pop();
             result.push_back(node);
             for (const auto& child : node->children) {
+                if (!child) continue;
                 queue.push(child);
             }
         }
@@ -100,10 +1104,17 @@ public:
             auto node = stack.top();
             stack.pop();
             for (auto it = node->children.rbegin(); it != node->children.rend(); ++it) {
+                if (!*it) continue;
                 stack.push(*it);
             }
             return *this;
         }
+
+        // Advance past the current node without descending into its children
+        PreOrderIterator& skip_subtree() {
+            stack.pop();
+            return *this;
+        }
     };
 
     PreOrderIterator begin_pre_order() {
@@ -115,6 +1126,11 @@ public:
         return PreOrderIterator(root);
     }
 
+    // Pre-order traversal of the subtree rooted at start
+    PreOrderIterator begin_pre_order(std::shared_ptr<Node<T>> start) {
+        return PreOrderIterator(start);
+    }
+
     PreOrderIterator end_pre_order() {
         return PreOrderIterator(nullptr);
     }
@@ -132,6 +1148,7 @@ public:
                     stack1.pop();
                     stack2.push(node);
                     for (auto& child : node->children) {
+                        if (!child) continue;
                         stack1.push(child);
                     }
                 }
@@ -163,6 +1180,11 @@ public:
         return PostOrderIterator(root);
     }
 
+    // Post-order traversal of the subtree rooted at start
+    PostOrderIterator begin_post_order(std::shared_ptr<Node<T>> start) {
+        return PostOrderIterator(start);
+    }
+
     PostOrderIterator end_post_order() {
         return PostOrderIterator(nullptr);
     }
@@ -214,6 +1236,11 @@ public:
         return InOrderIterator(root);
     }
 
+    // In-order traversal of the subtree rooted at start
+    InOrderIterator begin_in_order(std::shared_ptr<Node<T>> start) {
+        return InOrderIterator(start);
+    }
+
     InOrderIterator end_in_order() {
         return InOrderIterator(nullptr);
     }
@@ -245,16 +1272,28 @@ public:
             auto node = queue.front();
             queue.pop();
             for (const auto& child : node->children) {
+                if (!child) continue;
                 queue.push(child);
             }
             return *this;
         }
+
+        // Advance past the current node without enqueuing its children
+        BFSIterator& skip_subtree() {
+            queue.pop();
+            return *this;
+        }
     };
 
     BFSIterator begin_bfs_scan() {
         return BFSIterator(root);
     }
 
+    // BFS traversal of the subtree rooted at start
+    BFSIterator begin_bfs_scan(std::shared_ptr<Node<T>> start) {
+        return BFSIterator(start);
+    }
+
     BFSIterator end_bfs_scan() {
         return BFSIterator(nullptr);
     }
@@ -286,16 +1325,28 @@ public:
             auto node = stack.top();
             stack.pop();
             for (auto it = node->children.rbegin(); it != node->children.rend(); ++it) {
+                if (!*it) continue;
                 stack.push(*it);
             }
             return *this;
         }
+
+        // Advance past the current node without descending into its children
+        DFSIterator& skip_subtree() {
+            stack.pop();
+            return *this;
+        }
     };
 
     DFSIterator begin_dfs_scan() {
         return DFSIterator(root);
     }
 
+    // DFS traversal of the subtree rooted at start
+    DFSIterator begin_dfs_scan(std::shared_ptr<Node<T>> start) {
+        return DFSIterator(start);
+    }
+
     DFSIterator end_dfs_scan() {
         return DFSIterator(nullptr);
     }
@@ -305,32 +1356,14 @@ public:
     private:
         std::vector<std::shared_ptr<Node<T>>> heap;
         size_t index;
+        Compare compare;
 
         void heapify() {
-            for (size_t i = heap.size() / 2; i-- > 0;) {
-                sift_down(i);
-            }
-        }
-
-        void sift_down(size_t i) {
-            size_t left = 2 * i + 1;
-            size_t right = 2 * i + 2;
-            size_t smallest = i;
-
-            if (left < heap.size() && heap[left]->value < heap[smallest]->value) {
-                smallest = left;
-            }
-            if (right < heap.size() && heap[right]->value < heap[smallest]->value) {
-                smallest = right;
-            }
-            if (smallest != i) {
-                std::swap(heap[i], heap[smallest]);
-                sift_down(smallest);
-            }
+            Tree::heapify_nodes(heap, compare);
         }
 
     public:
-        HeapIterator(std::shared_ptr<Node<T>> root) : index(0) {
+        HeapIterator(std::shared_ptr<Node<T>> root, Compare compare = Compare()) : index(0), compare(compare) {
             if (root) {
                 std::queue<std::shared_ptr<Node<T>>> q;
                 q.push(root);
@@ -339,6 +1372,7 @@ public:
                     q.pop();
                     heap.push_back(node);
                     for (const auto& child : node->children) {
+                        if (!child) continue;
                         q.push(child);
                     }
                 }
@@ -346,11 +1380,18 @@ public:
             }
         }
 
+        bool at_end() const {
+            return index >= heap.size();
+        }
+
         bool operator!=(const HeapIterator& other) const {
-            return index != other.index;
+            return !(*this == other);
         }
 
         bool operator==(const HeapIterator& other) const {
+            if (at_end() || other.at_end()) {
+                return at_end() && other.at_end();
+            }
             return index == other.index;
         }
 
@@ -367,30 +1408,584 @@ public:
     };
 
     HeapIterator begin_heap() {
-        return HeapIterator(root);
+        return HeapIterator(root, compare);
+    }
+
+    // Heap order over the nodes of the subtree rooted at start
+    HeapIterator begin_heap(std::shared_ptr<Node<T>> start) {
+        return HeapIterator(start, compare);
     }
 
     HeapIterator end_heap() {
         return HeapIterator(nullptr);
     }
 
+    // Nodes in ascending value order, built on first use and then kept in step with push, pop,
+    // the key updates, add_sub_node, the BST operations and myHeap, so sorted scans never sort
+    // again. Ties keep pre-order when built and insertion order after that. add_root drops it.
+    const std::vector<Node<T>*>& sorted_index() const {
+        if (sorted_version != version) {
+            sorted_nodes = euler_tour().nodes();
+            sort_nodes_by_value(sorted_nodes);
+            sorted_version = version;
+            sorted_insert_hook = &sorted_insert_impl;
+            sorted_erase_hook = &sorted_erase_impl;
+        }
+        return sorted_nodes;
+    }
+
+    // Sorted-order iterator over the cached index
+    class SortedIterator {
+    private:
+        typename std::vector<Node<T>*>::const_iterator current;
+    public:
+        SortedIterator(typename std::vector<Node<T>*>::const_iterator current) : current(current) {}
+
+        bool operator!=(const SortedIterator& other) const {
+            return !(*this == other);
+        }
+
+        bool operator==(const SortedIterator& other) const {
+            return current == other.current;
+        }
+
+        Node<T>& operator*() {
+            return **current;
+        }
+
+        SortedIterator& operator++() {
+            ++current;
+            return *this;
+        }
+    };
+
+    SortedIterator begin_sorted() {
+        return SortedIterator(sorted_index().begin());
+    }
+
+    SortedIterator end_sorted() {
+        return SortedIterator(sorted_index().end());
+    }
+
+    // Value lookup on the sorted index: O(n log n) to rebuild after a mutation, O(log n) per
+    // lookup after that. Key may be any type ordered against T by operator<, such as a
+    // const char* against Tree<std::string>, so looking up does not construct a T.
+    // Equal values come back in sorted_index() order; find returns the first of them or nullptr.
+    // Nodes that have no handle because their parent link was never set are left out.
+    template <typename Key>
+    std::shared_ptr<Node<T>> find(const Key& key) const {
+        if (bloom_rejects(key)) return nullptr;
+        const std::vector<Node<T>*>& sorted = sorted_index();
+        auto it = std::lower_bound(sorted.begin(), sorted.end(), key, [](const Node<T>* node, const Key& k) {
+            return node->value < k;
+        });
+        for (; it != sorted.end() && !(key < (*it)->value); ++it) {
+            std::shared_ptr<Node<T>> handle = handle_of(*it);
+            if (handle) return handle;
+        }
+        return nullptr;
+    }
+
+    template <typename Key>
+    std::vector<std::shared_ptr<Node<T>>> find_all(const Key& key) const {
+        if (bloom_rejects(key)) return std::vector<std::shared_ptr<Node<T>>>();
+        const std::vector<Node<T>*>& sorted = sorted_index();
+        auto first = std::lower_bound(sorted.begin(), sorted.end(), key, [](const Node<T>* node, const Key& k) {
+            return node->value < k;
+        });
+        auto last = std::upper_bound(first, sorted.end(), key, [](const Key& k, const Node<T>* node) {
+            return k < node->value;
+        });
+        std::vector<std::shared_ptr<Node<T>>> matches;
+        matches.reserve(last - first);
+        for (; first != last; ++first) {
+            std::shared_ptr<Node<T>> handle = handle_of(*first);
+            if (handle) matches.push_back(handle);
+        }
+        return matches;
+    }
+
+    // All nodes with low <= value <= high in ascending order, O(log n + k) on the sorted index
+    template <typename Key>
+    std::vector<std::shared_ptr<Node<T>>> find_range(const Key& low, const Key& high) const {
+        const std::vector<Node<T>*>& sorted = sorted_index();
+        auto first = std::lower_bound(sorted.begin(), sorted.end(), low, [](const Node<T>* node, const Key& k) {
+            return node->value < k;
+        });
+        std::vector<std::shared_ptr<Node<T>>> matches;
+        for (; first != sorted.end() && !(high < (*first)->value); ++first) {
+            std::shared_ptr<Node<T>> handle = handle_of(*first);
+            if (handle) matches.push_back(handle);
+        }
+        return matches;
+    }
+
+    // First node in BFS order whose value satisfies pred, or nullptr; a linear scan
+    template <typename Predicate>
+    std::shared_ptr<Node<T>> find_if(Predicate pred) const {
+        if (!root) return nullptr;
+        std::queue<std::shared_ptr<Node<T>>> nodes;
+        nodes.push(root);
+        while (!nodes.empty()) {
+            auto current = nodes.front();
+            nodes.pop();
+            if (pred(current->value)) return current;
+            for (const auto& child : current->children) {
+                if (!child) continue;
+                nodes.push(child);
+            }
+        }
+        return nullptr;
+    }
+
+    // Optional Bloom filter over node values. While enabled, add_sub_node, find and find_all
+    // reject a value that is definitely absent in O(1) instead of scanning or building the
+    // sorted index. expected_items and false_positive_rate size it; it doubles when the tree
+    // outgrows it. Only trees that call this need a std::hash<T> specialization.
+    void enable_value_filter(size_t expected_items, double false_positive_rate = 0.01) {
+        bloom_capacity = std::max<size_t>(1, expected_items);
+        bloom_rate = false_positive_rate;
+        bloom_rebuild_hook = &bloom_rebuild_impl;
+        bloom_insert_hook = &bloom_insert_impl;
+        bloom_query_hook = &bloom_query_impl;
+        bloom_rebuild_impl(*this);
+    }
+
+    void disable_value_filter() {
+        bloom = BloomFilter<T>();
+        bloom_capacity = 0;
+        bloom_removed = 0;
+    }
+
+    // False only when no node holds value; always true while the filter is disabled
+    bool may_contain(const T& value) const {
+        return !bloom_rejects(value);
+    }
+
+    // Bit count, hash count, memory and expected false-positive rate of the current filter
+    const BloomFilter<T>& value_filter() const {
+        return bloom;
+    }
+
     // Convert tree to heap
+    // Gather, heapify and rewiring all run in parallel on large trees
     void myHeap() {
+        heap_mode = true;
+        bst_count = 0;
+        heap_nodes = gather_nodes();
+        heap_index.clear();
+        heap_indexed = false;
         if (!root) return;
-        std::vector<std::shared_ptr<Node<T>>> nodes = getNodesBFS();
-        std::make_heap(nodes.begin(), nodes.end(), [](const std::shared_ptr<Node<T>>& a, const std::shared_ptr<Node<T>>& b) {
-            return a->value > b->value;
-        });
+        std::vector<std::shared_ptr<Node<T>>>& nodes = heap_nodes;
+        heapify_nodes(nodes, compare);
         root = nodes.front();
-        for (size_t i = 0; i < nodes.size(); ++i) {
-            nodes[i]->children.clear();
-            if (2 * i + 1 < nodes.size()) {
-                nodes[i]->children.push_back(nodes[2 * i + 1]);
+        root->parent = nullptr;
+        // Each node rewrites only its own children and their parent links
+        parallel_for(nodes.size(), parallel_grain, [&nodes](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                nodes[i]->children.clear();
+                for (size_t c = K * i + 1; c <= K * i + K && c < nodes.size(); ++c) {
+                    nodes[i]->children.push_back(nodes[c]);
+                    nodes[c]->parent = nodes[i].get();
+                }
+            }
+        });
+        rebuild_aggregates();
+        // Same nodes and values, only relinked
+        bump_version_keep_sorted();
+    }
+
+    // Heap mode operations. "Min" is the value that comes first under Compare.
+    // Each one keeps the tree shaped as the heap, so every iterator still walks it. The mutating ones heapify a tree not yet in heap mode;
+    // peek() requires heap mode.
+
+    // Returns the new node's handle, usable with decrease_key, increase_key and erase
+    std::shared_ptr<Node<T>> push(const T& value) {
+        if (!heap_mode) myHeap();
+        std::shared_ptr<Node<T>> node = std::make_shared<Node<T>>(value);
+        sorted_insert(node.get());
+        heap_nodes.push_back(node);
+        size_t i = heap_nodes.size() - 1;
+        if (heap_indexed) {
+            heap_index[node.get()] = i;
+        }
+        if (i > 0) {
+            heap_nodes[(i - 1) / K]->children.push_back(nullptr);
+        }
+        heap_place(i);
+        heap_sift_up(i);
+        // Every position on the path from the new leaf to the root may hold a different node now
+        refresh_path(heap_nodes[i].get());
+        bloom_insert(value);
+        bump_version_keep_sorted();
+        return node;
+    }
+
+    const T& peek() const {
+        require_heap_top();
+        return heap_nodes.front()->value;
+    }
+
+    T pop_min() {
+        if (!heap_mode) myHeap();
+        require_heap_top();
+        return heap_erase_at(0)->value;
+    }
+
+    // Replaces the minimum with value and restores the heap; returns the old minimum
+    T replace_top(const T& value) {
+        if (!heap_mode) myHeap();
+        require_heap_top();
+        T old = heap_nodes.front()->value;
+        sorted_erase(heap_nodes.front().get());
+        heap_nodes.front()->value = value;
+        sorted_insert(heap_nodes.front().get());
+        bloom_remove();
+        bloom_insert(value);
+        size_t i = heap_sift_down(0);
+        refresh_path(heap_nodes[i].get());
+        bump_version_keep_sorted();
+        return old;
+    }
+
+    // Indexed heap operations on a node handle, O(log n). The handle must belong to the heap.
+    void decrease_key(std::shared_ptr<Node<T>> node, const T& value) {
+        size_t i = heap_position(node.get());
+        if (compare(node->value, value)) {
+            throw std::invalid_argument("Tree: decrease_key would increase the key");
+        }
+        sorted_erase(node.get());
+        node->value = value;
+        sorted_insert(node.get());
+        bloom_remove();
+        bloom_insert(value);
+        heap_sift_up(i);
+        refresh_path(heap_nodes[i].get());
+        bump_version_keep_sorted();
+    }
+
+    void increase_key(std::shared_ptr<Node<T>> node, const T& value) {
+        size_t i = heap_position(node.get());
+        if (compare(value, node->value)) {
+            throw std::invalid_argument("Tree: increase_key would decrease the key");
+        }
+        sorted_erase(node.get());
+        node->value = value;
+        sorted_insert(node.get());
+        bloom_remove();
+        bloom_insert(value);
+        size_t j = heap_sift_down(i);
+        refresh_path(heap_nodes[j].get());
+        bump_version_keep_sorted();
+    }
+
+    void erase(std::shared_ptr<Node<T>> node) {
+        heap_erase_at(heap_position(node.get()));
+    }
+
+    // Changes a node's value and keeps everything derived from values in sync: summaries,
+    // the sorted index, the value filter and, in heap mode, the heap order (through
+    // decrease_key or increase_key). In BST mode the node would land out of order, so that
+    // throws; use bst_erase and bst_insert there. O(K * depth) plus the index patch.
+    void set_value(std::shared_ptr<Node<T>> node, const T& value) {
+        if (!node || !owns(node.get())) {
+            throw std::invalid_argument("Tree: set_value needs a node of this tree");
+        }
+        if (bst_count > 0) {
+            throw std::logic_error("Tree: set_value would break BST order; use bst_erase and bst_insert");
+        }
+        if (heap_mode) {
+            if (compare(value, node->value)) {
+                decrease_key(node, value);
+            } else {
+                increase_key(node, value);
+            }
+            return;
+        }
+        sorted_erase(node.get());
+        node->value = value;
+        sorted_insert(node.get());
+        bloom_remove();
+        bloom_insert(value);
+        refresh_path(node.get());
+        bump_version_keep_sorted();
+    }
+
+    size_t heap_size() const {
+        return heap_mode ? heap_nodes.size() : 0;
+    }
+
+    // Binary search tree mode for Tree<T, 2>, ordered by Compare. Values are unique:
+    // inserting a present value returns the existing node. find and lower_bound are
+    // O(log n) worst case, insert and erase amortized O(log n). Nodes are relinked rather
+    // than having values swapped, so handles stay valid. Every iterator walks the result;
+    // in-order visits it sorted.
+    std::shared_ptr<Node<T>> bst_insert(const T& value) {
+        static_assert(K == 2, "BST mode requires a binary Tree");
+        bst_adopt();
+        leave_heap_mode();
+        std::shared_ptr<Node<T>> node = std::make_shared<Node<T>>(value);
+        if (!root) {
+            root = node;
+            bst_count = bst_max_count = 1;
+            refresh_path(node.get());
+            sorted_insert(node.get());
+            bloom_insert(value);
+            bump_version_keep_sorted();
+            return node;
+        }
+
+        Node<T>* current = root.get();
+        size_t depth = 0;
+        for (;;) {
+            size_t side;
+            if (compare(value, current->value)) {
+                side = 0;
+            } else if (compare(current->value, value)) {
+                side = 1;
+            } else {
+                return bst_handle(current);
+            }
+            ++depth;
+            Node<T>* next = bst_child(current, side);
+            if (!next) {
+                bst_set_child(current, side, node);
+                break;
+            }
+            current = next;
+        }
+        ++bst_count;
+        bst_max_count = std::max(bst_max_count, bst_count);
+        refresh_path(node.get());
+
+        if (depth > bst_depth_limit(bst_count)) {
+            // The scapegoat is the first ancestor with a child holding more than 2/3 of it
+            Node<T>* child = node.get();
+            size_t child_count = 1;
+            for (Node<T>* ancestor = child->parent; ancestor; ancestor = ancestor->parent) {
+                size_t count = 1 + child_count + bst_subtree_count(bst_child(ancestor, 1 - bst_side(ancestor, child)));
+                if (3 * child_count > 2 * count) {
+                    bst_rebuild(ancestor);
+                    break;
+                }
+                child = ancestor;
+                child_count = count;
+            }
+        }
+        sorted_insert(node.get());
+        bloom_insert(value);
+        bump_version_keep_sorted();
+        return node;
+    }
+
+    std::shared_ptr<Node<T>> bst_find(const T& value) const {
+        Node<T>* current = root.get();
+        while (current) {
+            if (compare(value, current->value)) {
+                current = bst_child(current, 0);
+            } else if (compare(current->value, value)) {
+                current = bst_child(current, 1);
+            } else {
+                return bst_handle(current);
+            }
+        }
+        return nullptr;
+    }
+
+    // First node whose value does not come before value, or null
+    std::shared_ptr<Node<T>> bst_lower_bound(const T& value) const {
+        Node<T>* current = root.get();
+        Node<T>* best = nullptr;
+        while (current) {
+            if (compare(current->value, value)) {
+                current = bst_child(current, 1);
+            } else {
+                best = current;
+                current = bst_child(current, 0);
+            }
+        }
+        return best ? bst_handle(best) : nullptr;
+    }
+
+    bool bst_erase(const T& value) {
+        static_assert(K == 2, "BST mode requires a binary Tree");
+        std::shared_ptr<Node<T>> node = bst_find(value);
+        if (!node) return false;
+        bst_adopt();
+        leave_heap_mode();
+
+        Node<T>* refresh_from;
+        if (!bst_child(node.get(), 0) || !bst_child(node.get(), 1)) {
+            std::shared_ptr<Node<T>> only;
+            for (const auto& child : node->children) {
+                if (child) only = child;
+            }
+            refresh_from = node->parent;
+            bst_replace(node.get(), only);
+        } else {
+            // Move the in-order successor into the erased node's place
+            std::shared_ptr<Node<T>> successor = node->children[1];
+            while (bst_child(successor.get(), 0)) {
+                successor = successor->children[0];
+            }
+            refresh_from = successor.get();
+            if (successor->parent != node.get()) {
+                refresh_from = successor->parent;
+                bst_replace(successor.get(), successor->children.size() > 1 ? successor->children[1] : nullptr);
+                bst_set_child(successor.get(), 1, node->children[1]);
+            }
+            bst_set_child(successor.get(), 0, node->children[0]);
+            bst_replace(node.get(), successor);
+        }
+        node->children.clear();
+        node->parent = nullptr;
+        aggregates.erase(node.get());
+        sorted_erase(node.get());
+        bloom_remove();
+        refresh_path(refresh_from);
+
+        --bst_count;
+        if (root && 3 * bst_count < 2 * bst_max_count) {
+            bst_rebuild(root.get());
+            bst_max_count = bst_count;
+        }
+        bump_version_keep_sorted();
+        return true;
+    }
+
+    size_t bst_size() const {
+        return bst_count;
+    }
+
+    // Entry/exit numbering of the current tree, rebuilt lazily after a mutation
+    const EulerTour<T>& euler_tour() const {
+        if (euler_version != version) {
+            euler.build(root);
+            euler_version = version;
+        }
+        return euler;
+    }
+
+    // O(1) after the Euler tour is built: true if ancestor is node or one of its ancestors
+    bool is_ancestor(std::shared_ptr<Node<T>> ancestor, std::shared_ptr<Node<T>> node) const {
+        return euler_tour().is_ancestor(ancestor.get(), node.get());
+    }
+
+    size_t subtree_size(std::shared_ptr<Node<T>> node) const {
+        return euler_tour().subtree_size(node.get());
+    }
+
+    // O(1) subtree summary maintained by the Aggregator policy
+    const aggregate_type& aggregate(std::shared_ptr<Node<T>> node) const {
+        return aggregates.at(node.get());
+    }
+
+    // Structural equality: the same shape with equal values in matching positions.
+    // With the MerkleHash aggregator this compares the two root hashes in O(1); two different
+    // trees compare equal only on a 64-bit hash collision. Other aggregators walk both trees, O(n).
+    bool operator==(const Tree& other) const {
+        if (!root || !other.root) return !root && !other.root;
+        return equal_nodes(other, std::is_same<Aggregator, MerkleHash<T>>());
+    }
+
+    bool operator!=(const Tree& other) const {
+        return !(*this == other);
+    }
+
+    // Positions where a and b differ, matching children by index: (x, y) where the values differ,
+    // (x, nullptr) for a subtree only in a and (nullptr, y) for one only in b, in pre-order.
+    // Subtrees with equal Merkle hashes are skipped, so the cost follows the changed paths
+    // rather than the tree size.
+    static std::vector<std::pair<Node<T>*, Node<T>*>> diff(const Tree& a, const Tree& b) {
+        static_assert(std::is_same<Aggregator, MerkleHash<T>>::value, "Tree::diff needs the MerkleHash aggregator");
+        std::vector<std::pair<Node<T>*, Node<T>*>> changes;
+        std::vector<std::pair<Node<T>*, Node<T>*>> stack(1, std::make_pair(a.root.get(), b.root.get()));
+        while (!stack.empty()) {
+            Node<T>* x = stack.back().first;
+            Node<T>* y = stack.back().second;
+            stack.pop_back();
+            if (!x || !y) {
+                if (x || y) changes.push_back(std::make_pair(x, y));
+                continue;
+            }
+            if (a.aggregates.find(x)->second == b.aggregates.find(y)->second) continue;
+            if (!(x->value == y->value)) changes.push_back(std::make_pair(x, y));
+            for (size_t i = std::max(x->children.size(), y->children.size()); i-- > 0;) {
+                stack.push_back(std::make_pair(i < x->children.size() ? x->children[i].get() : nullptr,
+                                               i < y->children.size() ? y->children[i].get() : nullptr));
             }
-            if (2 * i + 2 < nodes.size()) {
-                nodes[i]->children.push_back(nodes[2 * i + 2]);
+        }
+        return changes;
+    }
+
+    // Sparse-table LCA index, rebuilt lazily after a mutation
+    const LCAIndex<T>& lca_index() const {
+        if (lca_version != version) {
+            lca_table.build(euler_tour());
+            lca_version = version;
+        }
+        return lca_table;
+    }
+
+    Node<T>* lca(std::shared_ptr<Node<T>> a, std::shared_ptr<Node<T>> b) const {
+        return lca_index().query(a.get(), b.get());
+    }
+
+    // Answers a batch of LCA queries in one offline pass
+    std::vector<Node<T>*> lca(const std::vector<std::pair<std::shared_ptr<Node<T>>, std::shared_ptr<Node<T>>>>& queries) const {
+        std::vector<std::pair<const Node<T>*, const Node<T>*>> raw;
+        raw.reserve(queries.size());
+        for (const auto& query : queries) {
+            raw.push_back(std::make_pair(query.first.get(), query.second.get()));
+        }
+        return LCAIndex<T>::offline(euler_tour(), raw);
+    }
+
+    // Internal iteration: calls visitor(Node<T>&) on every node in the given order.
+    // Works on raw pointers over one local stack, so the loop inlines without per-step allocation.
+    // Adding or removing nodes during the visit is undefined. Writing node.value in place skips
+    // summaries, the sorted index, the value filter and heap order; use set_value for those.
+    template <typename Order, typename Visitor>
+    void visit(Visitor visitor) const {
+        visit<Order>(root, visitor);
+    }
+
+    template <typename Order, typename Visitor>
+    void visit(std::shared_ptr<Node<T>> start, Visitor visitor) const {
+        if (!start) return;
+        visit_impl(start.get(), visitor, Order());
+    }
+
+    // The k smallest values under cmp, in sorted order; pass std::greater<T>() for the largest.
+    // Streams a single traversal, never heapifying or copying the whole tree.
+    template <typename Select = std::less<T>>
+    std::vector<T> top_k(size_t k, Select cmp = Select()) const {
+        TopKCollector<Select> collector(k, cmp);
+        visit<PreOrder>([&collector](Node<T>& node) { collector.add(node.value); });
+        return collector.finish();
+    }
+
+    // Parallel top_k: each thread selects from its slice of the nodes, then the partial
+    // results are merged by one more selection
+    template <typename Select = std::less<T>>
+    std::vector<T> top_k_parallel(size_t k, Select cmp = Select()) const {
+        std::vector<std::shared_ptr<Node<T>>> nodes = gather_nodes();
+        size_t chunks = parallel_chunk_count(nodes.size(), parallel_grain);
+        std::vector<std::vector<T>> parts(chunks);
+        parallel_chunks(nodes.size(), chunks, [&nodes, &parts, k, cmp](size_t chunk, size_t begin, size_t end) {
+            TopKCollector<Select> collector(k, cmp);
+            for (size_t i = begin; i < end; ++i) {
+                collector.add(nodes[i]->value);
+            }
+            parts[chunk] = collector.finish();
+        });
+        TopKCollector<Select> merged(k, cmp);
+        for (const auto& part : parts) {
+            for (const auto& value : part) {
+                merged.add(value);
             }
         }
+        return merged.finish();
     }
 
     // Destructor to delete the entire tree
@@ -398,7 +1993,7 @@ public:
         root.reset();
     }
 
-    friend std::ostream& operator<<(std::ostream& os, const Tree<T, K>& tree) {
+    friend std::ostream& operator<<(std::ostream& os, const Tree& tree) {
         tree.print_tree(tree.root, 0);
         return os;
     }